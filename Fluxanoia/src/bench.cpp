@@ -0,0 +1,561 @@
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <random>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <fstream>
+#include <algorithm>
+
+#include "bvh.hpp"
+#include "buffer.hpp"
+#include "scene.hpp"
+#include "object.hpp"
+#include "packet.hpp"
+#include "render.hpp"
+#include "texture.hpp"
+#include "triangle.hpp"
+
+// Benchmarks for the renderer, run from the directory holding the
+// models, e.g. `bench threads`, `bench layout` or `bench filter`, with
+// no argument every benchmark is run, the spheres they need are written
+// beside the models as bench-sphere-<rings>x<segments>.obj
+
+namespace {
+
+const int size{ 512 };
+const int frames{ 16 };
+
+// Every heap allocation is counted, those at least as large as the
+// texture being watched are taken to be copies of it
+std::atomic<size_t> allocations{ 0 };
+std::atomic<size_t> allocated{ 0 };
+std::atomic<size_t> texture_sized{ 0 };
+std::atomic<size_t> texture_bytes{ static_cast<size_t>(-1) };
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - start).count();
+}
+
+// A unit sphere of 2 * segments * (rings - 1) triangles wound to face
+// outwards, it has no material library of its own and borrows the
+// cornell box's red, 8x8 has as many triangles as sphere.obj
+std::string sphereMesh(size_t rings, size_t segments) {
+	const std::string name{ "bench-sphere-" + std::to_string(rings)
+		+ "x" + std::to_string(segments) + ".obj" };
+	std::ofstream stream{ name };
+	stream << "o sphere\nusemtl Red\n";
+	stream << "v 0 1 0\n";
+	for (size_t r{ 1 }; r < rings; r++) {
+		const float theta{ 3.14159265f * r / rings };
+		for (size_t s{ 0 }; s < segments; s++) {
+			const float phi{ 6.28318531f * s / segments };
+			stream << "v " << std::sin(theta) * std::cos(phi) << " "
+				<< std::cos(theta) << " "
+				<< std::sin(theta) * std::sin(phi) << "\n";
+		}
+	}
+	stream << "v 0 -1 0\n";
+	const size_t bottom{ 2 + (rings - 1) * segments };
+	const auto index{ [segments](size_t r, size_t s) {
+		return 2 + (r - 1) * segments + s % segments;
+	} };
+	for (size_t s{ 0 }; s < segments; s++) {
+		stream << "f 1/ " << index(1, s + 1) << "/ " << index(1, s) << "/\n";
+		for (size_t r{ 1 }; r + 1 < rings; r++) {
+			stream << "f " << index(r, s) << "/ " << index(r + 1, s + 1)
+				<< "/ " << index(r + 1, s) << "/\n";
+			stream << "f " << index(r, s) << "/ " << index(r, s + 1)
+				<< "/ " << index(r + 1, s + 1) << "/\n";
+		}
+		stream << "f " << index(rings - 1, s) << "/ "
+			<< index(rings - 1, s + 1) << "/ " << bottom << "/\n";
+	}
+	return name;
+}
+
+// The cornell box, with a dense sphere standing in it when asked for
+void loadScene(Scene& scene, bool dense) {
+	scene.loadObject("textured-cornell-box.obj", 0.4f, size / 2.4f);
+	if (dense) scene.loadObject(sphereMesh(250, 200), 0.25f, size / 2.4f);
+}
+
+// The cornell box and, when asked for, the dense sphere as the scene
+// holds them
+std::vector<std::pair<Object, float>> loadObjects(bool dense) {
+	std::vector<std::pair<Object, float>> objects{ };
+	objects.push_back({ Object{ "textured-cornell-box.obj", 0.4f }, size / 2.4f });
+	if (dense) objects.push_back({ Object{ sphereMesh(250, 200), 0.25f }, size / 2.4f });
+	return objects;
+}
+
+// The objects' triangles in load order, built the way the BVH builds
+// them
+std::vector<Triangle> trianglesOf(const std::vector<std::pair<Object, float>>& objects) {
+	std::vector<Triangle> triangles{ };
+	for (size_t o{ 0 }; o < objects.size(); o++) {
+		const std::vector<Element>& elements{ objects[o].first.getElements() };
+		for (size_t e{ 0 }; e < elements.size(); e++) {
+			const Element& elem{ elements[e] };
+			for (size_t f{ 0 }; f < elem.faces.size(); f++) {
+				const Face& face{ elem.faces[f] };
+				triangles.push_back({ o, e, f, elem.points.at(face.a),
+					elem.points.at(face.b), elem.points.at(face.c) });
+			}
+		}
+	}
+	return triangles;
+}
+
+// Frames of the textured cornell box are drawn in each mode with the
+// world turning between them, and everything they allocate is counted
+void benchAllocations(DrawingWindow& window) {
+	const TextureMap texture{ "texture.ppm" };
+	texture_bytes = texture.pixels.size() * sizeof(uint32_t);
+	std::printf("allocations: per frame, allocations, KB, texture copies\n");
+	for (RenderMode mode : { RenderMode::WIRE, RenderMode::RASTER, RenderMode::RAYTRACED }) {
+		Scene scene{ { 0, 0, 4 }, 2 };
+		loadScene(scene, false);
+		scene.setRenderMode(mode);
+		scene.draw(window);
+		allocations = 0;
+		allocated = 0;
+		texture_sized = 0;
+		for (int f{ 0 }; f < frames; f++) {
+			scene.rotateWorld({ 0, (f % 2) ? 0.05f : -0.05f, 0 });
+			scene.lookAt({ 0, 0, 0 });
+			window.clearPixels();
+			scene.draw(window);
+		}
+		std::printf("  %-9s %8.1f %8.1f %6.1f\n", mode == RenderMode::WIRE ? "WIRE"
+			: mode == RenderMode::RASTER ? "RASTER" : "RAYTRACED",
+			static_cast<double>(allocations) / frames,
+			allocated / 1024.0 / frames,
+			static_cast<double>(texture_sized) / frames);
+	}
+	texture_bytes = static_cast<size_t>(-1);
+}
+
+// Rays from one eye fan over the sphere and the wall behind it
+std::vector<glm::vec3> fanRays(const glm::vec3& eye, size_t side) {
+	std::vector<glm::vec3> rays{ };
+	for (size_t y{ 0 }; y < side; y++) {
+		for (size_t x{ 0 }; x < side; x++) {
+			rays.push_back(glm::vec3{ x / (side - 1.0f) - 0.5f,
+				y / (side - 1.0f) - 0.5f, 0 } - eye);
+		}
+	}
+	return rays;
+}
+
+// The test every ray/triangle pair went through before the Moller-
+// Trumbore kernel, the matrix of the ray and edges is inverted and the
+// solution checked for infinities
+bool inverseIntersect(const glm::vec3& from, const glm::vec3& ray,
+	const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+	const glm::vec3 s{ glm::inverse(glm::mat3{ -ray, b - a, c - a }) * (from - a) };
+	for (int i{ 0 }; i < 3; i++) {
+		if (std::isinf(s[i]) || std::isnan(s[i])) return false;
+	}
+	if (s[0] < 0) return false;
+	if (s[1] < 0 || s[1] > 1) return false;
+	if (s[2] < 0 || s[2] > 1) return false;
+	return s[1] + s[2] < 1;
+}
+
+// Both tests see the same ray/triangle pairs, the hit counts should
+// match but for pairs grazing an edge
+void benchIntersect() {
+	const std::vector<Triangle> triangles{ trianglesOf(loadObjects(true)) };
+	std::vector<glm::mat3> corners{ };
+	for (const Triangle& t : triangles) corners.push_back({ t.a, t.b(), t.c() });
+	const glm::vec3 eye{ 0, 0, 3 };
+	const std::vector<glm::vec3> rays{ fanRays(eye, 16) };
+	const double tests{ static_cast<double>(rays.size()) * triangles.size() };
+	std::printf("intersect: ns/test (hits) over %zu triangles\n", triangles.size());
+
+	size_t hits{ 0 };
+	auto start{ std::chrono::steady_clock::now() };
+	for (const glm::vec3& ray : rays) {
+		for (const glm::mat3& c : corners) {
+			hits += inverseIntersect(eye, ray, c[0], c[1], c[2]);
+		}
+	}
+	std::printf("  %-9s %8.2f (%zu)\n", "inverse", 1e9 * secondsSince(start) / tests, hits);
+
+	hits = 0;
+	start = std::chrono::steady_clock::now();
+	for (const glm::vec3& ray : rays) {
+		for (const Triangle& t : triangles) {
+			Hit hit{ };
+			hits += t.intersect(eye, ray, 0, std::numeric_limits<float>::max(), hit);
+		}
+	}
+	std::printf("  %-9s %8.2f (%zu)\n", "triangle", 1e9 * secondsSince(start) / tests, hits);
+}
+
+// Every ray is tested against every triangle of the dense scene, once
+// through the structures and once through the buffer's batches, and
+// both copies are weighed against the BVH that keeps them together
+void benchStorage() {
+	const std::vector<std::pair<Object, float>> objects{ loadObjects(true) };
+	const std::vector<Triangle> triangles{ trianglesOf(objects) };
+	TriangleBuffer buffer{ };
+	buffer.build(triangles);
+	BVH bvh{ };
+	bvh.build(objects);
+	const glm::vec3 eye{ 0, 0, 3 };
+	const std::vector<glm::vec3> rays{ fanRays(eye, 16) };
+	const double tests{ static_cast<double>(rays.size()) * triangles.size() };
+	const float far{ std::numeric_limits<float>::max() };
+	std::printf("storage: MB, ns/test (hits) over %zu triangles\n", triangles.size());
+
+	size_t hits{ 0 };
+	auto start{ std::chrono::steady_clock::now() };
+	for (const glm::vec3& ray : rays) {
+		Hit hit{ };
+		float t_max{ far };
+		for (const Triangle& t : triangles) {
+			if (t.intersect(eye, ray, 0, t_max, hit)) t_max = hit.t;
+		}
+		hits += t_max < far;
+	}
+	std::printf("  %-10s %8.2f %8.2f (%zu)\n", "structures",
+		triangles.size() * sizeof(Triangle) / 1e6,
+		1e9 * secondsSince(start) / tests, hits);
+
+	hits = 0;
+	start = std::chrono::steady_clock::now();
+	for (const glm::vec3& ray : rays) {
+		Hit hit{ };
+		hits += buffer.closest(0, triangles.size(), eye, ray, 0, far, hit);
+	}
+	std::printf("  %-10s %8.2f %8.2f (%zu)\n", "buffer", buffer.memory() / 1e6,
+		1e9 * secondsSince(start) / tests, hits);
+	std::printf("  %-10s %8.2f, both copies and the nodes\n", "BVH", bvh.memory() / 1e6);
+}
+
+// A frame's worth of hits on the sphere is shaded with normals rebuilt
+// from every face of the element, the way shading used to, and with
+// the vertex normals the object now keeps, the rebuilt normals are
+// only worked out for every step'th hit and scaled up to the frame,
+// the sum keeps the compiler from dropping the normals
+void benchShading() {
+	const glm::vec3 eye{ 0, 0, 3 };
+	const std::vector<glm::vec3> rays{ fanRays(eye, size) };
+	std::printf("shading: ms/frame of normals (hits)\n");
+	for (size_t rings : { 8, 250 }) {
+		std::vector<std::pair<Object, float>> objects{ };
+		objects.push_back({ Object{ sphereMesh(rings, rings == 8 ? 8 : 200), 1.0f }, 1.0f });
+		BVH bvh{ };
+		bvh.build(objects);
+		std::vector<Hit> hits{ };
+		for (const glm::vec3& ray : rays) {
+			Hit hit{ };
+			if (bvh.closest(eye, ray, hit)) hits.push_back(hit);
+		}
+		const std::vector<Element>& elements{ objects.front().first.getElements() };
+		const size_t faces{ bvh.getTriangleCount() };
+		const size_t step{ std::max<size_t>(1, hits.size() * faces / 200000000) };
+		std::printf("  %zu triangles\n", faces);
+
+		glm::vec3 sum{ 0, 0, 0 };
+		auto start{ std::chrono::steady_clock::now() };
+		for (size_t i{ 0 }; i < hits.size(); i += step) {
+			const Hit& hit{ hits[i] };
+			const Triangle& t{ bvh.getTriangle(hit.triangle) };
+			const Element& elem{ elements[t.element] };
+			const Face& face{ elem.faces[t.face] };
+			glm::vec3 na{ 0, 0, 0 }, nb{ 0, 0, 0 }, nc{ 0, 0, 0 };
+			for (const Face& f : elem.faces) {
+				for (auto p : { f.a, f.b, f.c }) {
+					if (p == face.a) na += f.normal;
+					if (p == face.b) nb += f.normal;
+					if (p == face.c) nc += f.normal;
+				}
+			}
+			sum += glm::normalize(na * (1 - hit.u - hit.v) + nb * hit.u + nc * hit.v);
+		}
+		std::printf("    %-8s %10.2f (%zu, every %zu timed)\n", "rebuilt",
+			1000 * secondsSince(start) * step, hits.size(), step);
+
+		start = std::chrono::steady_clock::now();
+		for (const Hit& hit : hits) {
+			const Triangle& t{ bvh.getTriangle(hit.triangle) };
+			const Element& elem{ elements[t.element] };
+			const Face& face{ elem.faces[t.face] };
+			sum += glm::normalize(elem.normals[face.a] * (1 - hit.u - hit.v)
+				+ elem.normals[face.b] * hit.u + elem.normals[face.c] * hit.v);
+		}
+		std::printf("    %-8s %10.2f (%zu, %.0f)\n", "vertex",
+			1000 * secondsSince(start), hits.size(), sum[0] + sum[1] + sum[2]);
+	}
+}
+
+// Packets take 2x2 blocks of the fan the way the ray tracer takes
+// blocks of pixels, brute force packets test every triangle in turn
+void benchPackets() {
+	const glm::vec3 eye{ 0, 0, 3 };
+	const size_t side{ 128 };
+	const std::vector<glm::vec3> rays{ fanRays(eye, side) };
+	std::printf("packets: rays/s (hits)\n");
+	for (bool dense : { false, true }) {
+		const std::vector<std::pair<Object, float>> objects{ loadObjects(dense) };
+		const std::vector<Triangle> triangles{ trianglesOf(objects) };
+		BVH bvh{ };
+		bvh.build(objects);
+		std::printf("  %zu triangles\n", triangles.size());
+
+		size_t hits{ 0 };
+		auto start{ std::chrono::steady_clock::now() };
+		for (const glm::vec3& ray : rays) {
+			Hit hit{ };
+			hits += bvh.closest(eye, ray, hit);
+		}
+		std::printf("    %-13s %10.0f (%zu)\n", "scalar BVH",
+			rays.size() / secondsSince(start), hits);
+
+		for (bool brute : { false, true }) {
+			hits = 0;
+			start = std::chrono::steady_clock::now();
+			for (size_t y{ 0 }; y < side; y += 2) {
+				for (size_t x{ 0 }; x < side; x += 2) {
+					RayPacket packet{ eye };
+					for (int lane{ 0 }; lane < RayPacket::size; lane++) {
+						packet.add(lane, rays[(y + lane / 2) * side + x + lane % 2]);
+					}
+					if (brute) packet.intersect(triangles);
+					else bvh.closest(packet);
+					for (int lane{ 0 }; lane < RayPacket::size; lane++) {
+						hits += (packet.hits >> lane) & 1;
+					}
+				}
+			}
+			std::printf("    %-13s %10.0f (%zu)\n", brute ? "packet brute" : "packet BVH",
+				rays.size() / secondsSince(start), hits);
+		}
+	}
+}
+
+// Frames of the dense scene are drawn with 1, 2, 4... workers and
+// finally the hardware's count, the world turns between frames so no
+// cached hit is reused
+void benchThreads(DrawingWindow& window) {
+	const size_t cores{ std::max(1u, std::thread::hardware_concurrency()) };
+	std::printf("threads: ms/frame (speedup over 1 thread)\n");
+	for (RenderMode mode : { RenderMode::RASTER, RenderMode::RAYTRACED }) {
+		double single{ 0 };
+		Scene scene{ { 0, 0, 4 }, 2 };
+		loadScene(scene, true);
+		scene.setRenderMode(mode);
+		for (size_t threads{ 1 }; ; threads = std::min(2 * threads, cores)) {
+			scene.setThreads(threads);
+			scene.draw(window);
+			const auto start{ std::chrono::steady_clock::now() };
+			for (int f{ 0 }; f < frames; f++) {
+				scene.rotateWorld({ 0, (f % 2) ? 0.05f : -0.05f, 0 });
+				scene.lookAt({ 0, 0, 0 });
+				window.clearPixels();
+				scene.draw(window);
+			}
+			const double ms{ 1000 * secondsSince(start) / frames };
+			if (threads == 1) single = ms;
+			std::printf("  %-9s %2zu threads %8.2f (%.2fx)\n",
+				mode == RenderMode::RASTER ? "RASTER" : "RAYTRACED",
+				threads, ms, single / ms);
+			if (threads == cores) break;
+		}
+	}
+}
+
+// The sphere's back half hides behind its front half and both hide
+// part of the box, what the hierarchical depth skipped is averaged
+// over the turning frames for either rasteriser
+void benchCulling(DrawingWindow& window) {
+	std::printf("culling: ms/frame, culled triangles/frame (of all), culled pixels/frame\n");
+	for (bool dense : { false, true }) {
+		const size_t total{ trianglesOf(loadObjects(dense)).size() };
+		for (Rasteriser rasteriser : { Rasteriser::SCANLINE, Rasteriser::HALFSPACE }) {
+			Scene scene{ { 0, 0, 4 }, 2 };
+			loadScene(scene, dense);
+			scene.setRenderMode(RenderMode::RASTER);
+			scene.setRasteriser(rasteriser);
+			scene.draw(window);
+			size_t triangles{ 0 }, pixels{ 0 };
+			const auto start{ std::chrono::steady_clock::now() };
+			for (int f{ 0 }; f < frames; f++) {
+				scene.rotateWorld({ 0, (f % 2) ? 0.05f : -0.05f, 0 });
+				scene.lookAt({ 0, 0, 0 });
+				window.clearPixels();
+				scene.draw(window);
+				triangles += scene.getCulledTriangles();
+				pixels += scene.getCulledPixels();
+			}
+			std::printf("  %6zu triangles %-9s %8.2f %8zu (%zu) %10zu\n", total,
+				rasteriser == Rasteriser::HALFSPACE ? "HALFSPACE" : "SCANLINE",
+				1000 * secondsSince(start) / frames,
+				triangles / frames, total, pixels / frames);
+		}
+	}
+}
+
+// The cornell box is traced with and without adaptive anti-aliasing,
+// samples per pixel are averaged over the turning frames
+void benchAntialiasing(DrawingWindow& window) {
+	std::printf("antialiasing: ms/frame, samples/pixel\n");
+	for (bool antialiasing : { false, true }) {
+		Scene scene{ { 0, 0, 4 }, 2 };
+		loadScene(scene, false);
+		scene.setRenderMode(RenderMode::RAYTRACED);
+		scene.setAntialiasing(antialiasing);
+		scene.draw(window);
+		double samples{ 0 };
+		const auto start{ std::chrono::steady_clock::now() };
+		for (int f{ 0 }; f < frames; f++) {
+			scene.rotateWorld({ 0, (f % 2) ? 0.05f : -0.05f, 0 });
+			scene.lookAt({ 0, 0, 0 });
+			window.clearPixels();
+			scene.draw(window);
+			samples += scene.getSamplesPerPixel();
+		}
+		std::printf("  %-4s %8.2f %6.2f\n", antialiasing ? "on" : "off",
+			1000 * secondsSince(start) / frames, samples / frames);
+	}
+}
+
+// Random triangles of a few pixels and of tens of pixels are filled
+// and textured through either rasteriser, each at a random depth so
+// some fail the depth test, the same seed gives the same triangles
+void benchRaster(DrawingWindow& window) {
+	Render::TextureRegistry textures{ };
+	const Render::Sampler& map{ textures.sampler(textures.load("texture.ppm")) };
+	std::vector<float> depth(size * size, 0);
+	const size_t count{ 200000 };
+	std::printf("raster: Mtriangles/s\n");
+	for (float extent : { 4.0f, 48.0f }) {
+		for (bool textured : { false, true }) {
+			for (Rasteriser rasteriser : { Rasteriser::SCANLINE, Rasteriser::HALFSPACE }) {
+				std::mt19937 random{ 1 };
+				std::uniform_real_distribution<float> position{ 0, size - extent };
+				std::uniform_real_distribution<float> offset{ 0, extent };
+				std::uniform_real_distribution<float> texel_x{ 0, map.width - 1.0f };
+				std::uniform_real_distribution<float> texel_y{ 0, map.height - 1.0f };
+				window.clearPixels();
+				std::fill(depth.begin(), depth.end(), 0.0f);
+				const auto start{ std::chrono::steady_clock::now() };
+				for (size_t i{ 0 }; i < count; i++) {
+					const float x{ position(random) }, y{ position(random) };
+					const float z{ 1 + offset(random) };
+					CanvasTriangle t{ };
+					for (int p{ 0 }; p < 3; p++) {
+						t[p] = { x + offset(random), y + offset(random), z };
+						t[p].texturePoint = { texel_x(random), texel_y(random) };
+					}
+					if (textured) Render::mapTriangle(window, t, map, &depth, rasteriser);
+					else Render::fillTriangle(window, t, { 255, 0, 0 }, 255, &depth, rasteriser);
+				}
+				std::printf("  %4.0fpx %-6s %-9s %8.3f\n", extent,
+					textured ? "mapped" : "filled",
+					rasteriser == Rasteriser::HALFSPACE ? "HALFSPACE" : "SCANLINE",
+					count / secondsSince(start) / 1e6);
+			}
+		}
+	}
+}
+
+// A screen filling quad maps a turning window of the texture, so
+// samples walk across its rows at every angle
+void benchLayout(DrawingWindow& window) {
+	Render::TextureRegistry textures{ };
+	const size_t handle{ textures.load("texture.ppm") };
+	std::vector<float> depth(size * size, 0);
+	std::printf("layout: ms/frame\n");
+	for (TextureLayout layout : { TextureLayout::LINEAR, TextureLayout::TILED }) {
+		textures.setLayout(layout);
+		const Render::Sampler& map{ textures.sampler(handle) };
+		const float centre_x{ map.width / 2.0f }, centre_y{ map.height / 2.0f };
+		const float radius{ std::min(centre_x, centre_y) * 0.7f };
+		double total{ 0 };
+		for (int f{ 0 }; f < frames; f++) {
+			const float angle{ f * 0.3f };
+			CanvasPoint corners[4]{ { 0, 0, 1 }, { size - 1.0f, 0, 1 },
+				{ size - 1.0f, size - 1.0f, 1 }, { 0, size - 1.0f, 1 } };
+			for (int c{ 0 }; c < 4; c++) {
+				const float a{ angle + 3.927f + c * 1.5708f };
+				corners[c].texturePoint = { centre_x + radius * std::cos(a),
+					centre_y + radius * std::sin(a) };
+			}
+			window.clearPixels();
+			std::fill(depth.begin(), depth.end(), 0.0f);
+			const auto start{ std::chrono::steady_clock::now() };
+			Render::mapTriangle(window, { corners[0], corners[1], corners[2] }, map, &depth);
+			Render::mapTriangle(window, { corners[0], corners[2], corners[3] }, map, &depth);
+			total += secondsSince(start);
+		}
+		std::printf("  %-6s %8.2f\n", layout == TextureLayout::TILED
+			? "TILED" : "LINEAR", 1000 * total / frames);
+	}
+}
+
+// Samples walk along rows like a span does, the sum keeps the compiler
+// from dropping the lookups
+void benchFilter() {
+	Render::TextureRegistry textures{ };
+	const Render::Sampler& map{ textures.sampler(textures.load("texture.ppm")) };
+	const size_t samples{ 1 << 22 };
+	std::vector<float> xs(samples), ys(samples);
+	for (size_t i{ 0 }; i < samples; i++) {
+		xs[i] = std::fmod(i * 0.37f, map.width - 1.0f);
+		ys[i] = std::fmod((i / 1024) * 0.61f, map.height - 1.0f);
+	}
+	std::printf("filter: ns/sample\n");
+	for (TextureFilter filter : { TextureFilter::NEAREST, TextureFilter::BILINEAR }) {
+		textures.setFilter(filter);
+		uint32_t sum{ 0 };
+		const auto start{ std::chrono::steady_clock::now() };
+		for (size_t i{ 0 }; i < samples; i++) {
+			sum += Render::sampleTexture(map, xs[i], ys[i]);
+		}
+		std::printf("  %-8s %8.2f (%08x)\n", filter == TextureFilter::BILINEAR
+			? "BILINEAR" : "NEAREST", 1e9 * secondsSince(start) / samples, sum);
+	}
+}
+
+}
+
+void* operator new(size_t bytes) {
+	allocations++;
+	allocated += bytes;
+	if (bytes >= texture_bytes) texture_sized++;
+	if (void* pointer{ std::malloc(bytes > 0 ? bytes : 1) }) return pointer;
+	throw std::bad_alloc{ };
+}
+void operator delete(void* pointer) noexcept {
+	std::free(pointer);
+}
+void operator delete(void* pointer, size_t) noexcept {
+	std::free(pointer);
+}
+
+int main(int n, char *args[]) {
+	const std::string only{ n > 1 ? args[1] : "" };
+	DrawingWindow window{ size, size, false };
+	if (only.empty() || only == "threads") benchThreads(window);
+	if (only.empty() || only == "allocations") benchAllocations(window);
+	if (only.empty() || only == "culling") benchCulling(window);
+	if (only.empty() || only == "antialiasing") benchAntialiasing(window);
+	if (only.empty() || only == "raster") benchRaster(window);
+	if (only.empty() || only == "layout") benchLayout(window);
+	if (only.empty() || only == "filter") benchFilter();
+	if (only.empty() || only == "intersect") benchIntersect();
+	if (only.empty() || only == "storage") benchStorage();
+	if (only.empty() || only == "packets") benchPackets();
+	if (only.empty() || only == "shading") benchShading();
+	return 0;
+}
@@ -0,0 +1,212 @@
+#include "buffer.hpp"
+
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+const size_t TriangleBuffer::width{ 8 };
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+const size_t TriangleBuffer::width{ 4 };
+#else
+const size_t TriangleBuffer::width{ 1 };
+#endif
+
+void TriangleBuffer::build(const std::vector<Triangle>& triangles) {
+	// Padding past the last triangle lets a batch start anywhere, the
+	// zeroed edges give a zero determinant so the padding never hits
+	total = triangles.size();
+	stride = (total + width + 6) / 8 * 8;
+	storage.assign(COMPONENTS * stride, 0.0f);
+
+	float* data{ storage.data() };
+	for (size_t i{ 0 }; i < total; i++) {
+		const Triangle& t{ triangles.at(i) };
+		data[X0 * stride + i] = t.a[0];
+		data[Y0 * stride + i] = t.a[1];
+		data[Z0 * stride + i] = t.a[2];
+		data[E1X * stride + i] = t.e1[0];
+		data[E1Y * stride + i] = t.e1[1];
+		data[E1Z * stride + i] = t.e1[2];
+		data[E2X * stride + i] = t.e2[0];
+		data[E2Y * stride + i] = t.e2[1];
+		data[E2Z * stride + i] = t.e2[2];
+	}
+}
+size_t TriangleBuffer::memory() const {
+	return storage.capacity() * sizeof(float);
+}
+
+const float* TriangleBuffer::_component(Component component) const {
+	return storage.data() + component * stride;
+}
+
+int TriangleBuffer::_test(size_t index,
+	const glm::vec3& from,
+	const glm::vec3& ray,
+	float t_min, float t_max,
+	float* t, float* u, float* v) const {
+	// Moller-Trumbore with one triangle per lane, the bounds are checked
+	// against determinant-scaled values and the division is only done
+	// once some lane of the batch has been accepted
+#if defined(__AVX__)
+	const __m256 ax{ _mm256_loadu_ps(this->_component(X0) + index) };
+	const __m256 ay{ _mm256_loadu_ps(this->_component(Y0) + index) };
+	const __m256 az{ _mm256_loadu_ps(this->_component(Z0) + index) };
+	const __m256 e1x{ _mm256_loadu_ps(this->_component(E1X) + index) };
+	const __m256 e1y{ _mm256_loadu_ps(this->_component(E1Y) + index) };
+	const __m256 e1z{ _mm256_loadu_ps(this->_component(E1Z) + index) };
+	const __m256 e2x{ _mm256_loadu_ps(this->_component(E2X) + index) };
+	const __m256 e2y{ _mm256_loadu_ps(this->_component(E2Y) + index) };
+	const __m256 e2z{ _mm256_loadu_ps(this->_component(E2Z) + index) };
+	const __m256 dx{ _mm256_set1_ps(ray[0]) };
+	const __m256 dy{ _mm256_set1_ps(ray[1]) };
+	const __m256 dz{ _mm256_set1_ps(ray[2]) };
+	const __m256 zero{ _mm256_setzero_ps() };
+
+	const __m256 px{ _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y)) };
+	const __m256 py{ _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z)) };
+	const __m256 pz{ _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x)) };
+	__m256 det{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px),
+		_mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz)) };
+	const __m256 sign{ _mm256_and_ps(det, _mm256_set1_ps(-0.0f)) };
+	det = _mm256_xor_ps(det, sign);
+
+	const __m256 sx{ _mm256_sub_ps(_mm256_set1_ps(from[0]), ax) };
+	const __m256 sy{ _mm256_sub_ps(_mm256_set1_ps(from[1]), ay) };
+	const __m256 sz{ _mm256_sub_ps(_mm256_set1_ps(from[2]), az) };
+	const __m256 lane_u{ _mm256_xor_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, px),
+		_mm256_mul_ps(sy, py)), _mm256_mul_ps(sz, pz)), sign) };
+	const __m256 qx{ _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y)) };
+	const __m256 qy{ _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z)) };
+	const __m256 qz{ _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x)) };
+	const __m256 lane_v{ _mm256_xor_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx),
+		_mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)), sign) };
+	const __m256 lane_t{ _mm256_xor_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx),
+		_mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)), sign) };
+
+	__m256 valid{ _mm256_cmp_ps(det, zero, _CMP_NEQ_OQ) };
+	valid = _mm256_and_ps(valid, _mm256_cmp_ps(lane_u, zero, _CMP_GE_OQ));
+	valid = _mm256_and_ps(valid, _mm256_cmp_ps(lane_u, det, _CMP_LE_OQ));
+	valid = _mm256_and_ps(valid, _mm256_cmp_ps(lane_v, zero, _CMP_GE_OQ));
+	valid = _mm256_and_ps(valid, _mm256_cmp_ps(
+		_mm256_add_ps(lane_u, lane_v), det, _CMP_LT_OQ));
+	valid = _mm256_and_ps(valid, _mm256_cmp_ps(
+		lane_t, _mm256_mul_ps(_mm256_set1_ps(t_min), det), _CMP_GT_OQ));
+	valid = _mm256_and_ps(valid, _mm256_cmp_ps(
+		lane_t, _mm256_mul_ps(_mm256_set1_ps(t_max), det), _CMP_LT_OQ));
+	const int mask{ _mm256_movemask_ps(valid) };
+	if (mask == 0) return 0;
+
+	const __m256 inverse{ _mm256_div_ps(_mm256_set1_ps(1.0f), det) };
+	_mm256_storeu_ps(t, _mm256_mul_ps(lane_t, inverse));
+	_mm256_storeu_ps(u, _mm256_mul_ps(lane_u, inverse));
+	_mm256_storeu_ps(v, _mm256_mul_ps(lane_v, inverse));
+	return mask;
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	const __m128 ax{ _mm_loadu_ps(this->_component(X0) + index) };
+	const __m128 ay{ _mm_loadu_ps(this->_component(Y0) + index) };
+	const __m128 az{ _mm_loadu_ps(this->_component(Z0) + index) };
+	const __m128 e1x{ _mm_loadu_ps(this->_component(E1X) + index) };
+	const __m128 e1y{ _mm_loadu_ps(this->_component(E1Y) + index) };
+	const __m128 e1z{ _mm_loadu_ps(this->_component(E1Z) + index) };
+	const __m128 e2x{ _mm_loadu_ps(this->_component(E2X) + index) };
+	const __m128 e2y{ _mm_loadu_ps(this->_component(E2Y) + index) };
+	const __m128 e2z{ _mm_loadu_ps(this->_component(E2Z) + index) };
+	const __m128 dx{ _mm_set1_ps(ray[0]) };
+	const __m128 dy{ _mm_set1_ps(ray[1]) };
+	const __m128 dz{ _mm_set1_ps(ray[2]) };
+	const __m128 zero{ _mm_setzero_ps() };
+
+	const __m128 px{ _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y)) };
+	const __m128 py{ _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z)) };
+	const __m128 pz{ _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x)) };
+	__m128 det{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px),
+		_mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz)) };
+	const __m128 sign{ _mm_and_ps(det, _mm_set1_ps(-0.0f)) };
+	det = _mm_xor_ps(det, sign);
+
+	const __m128 sx{ _mm_sub_ps(_mm_set1_ps(from[0]), ax) };
+	const __m128 sy{ _mm_sub_ps(_mm_set1_ps(from[1]), ay) };
+	const __m128 sz{ _mm_sub_ps(_mm_set1_ps(from[2]), az) };
+	const __m128 lane_u{ _mm_xor_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px),
+		_mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), sign) };
+	const __m128 qx{ _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y)) };
+	const __m128 qy{ _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z)) };
+	const __m128 qz{ _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x)) };
+	const __m128 lane_v{ _mm_xor_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx),
+		_mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), sign) };
+	const __m128 lane_t{ _mm_xor_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx),
+		_mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), sign) };
+
+	__m128 valid{ _mm_cmpneq_ps(det, zero) };
+	valid = _mm_and_ps(valid, _mm_cmpge_ps(lane_u, zero));
+	valid = _mm_and_ps(valid, _mm_cmple_ps(lane_u, det));
+	valid = _mm_and_ps(valid, _mm_cmpge_ps(lane_v, zero));
+	valid = _mm_and_ps(valid, _mm_cmplt_ps(_mm_add_ps(lane_u, lane_v), det));
+	valid = _mm_and_ps(valid, _mm_cmpgt_ps(lane_t, _mm_mul_ps(_mm_set1_ps(t_min), det)));
+	valid = _mm_and_ps(valid, _mm_cmplt_ps(lane_t, _mm_mul_ps(_mm_set1_ps(t_max), det)));
+	const int mask{ _mm_movemask_ps(valid) };
+	if (mask == 0) return 0;
+
+	const __m128 inverse{ _mm_div_ps(_mm_set1_ps(1.0f), det) };
+	_mm_storeu_ps(t, _mm_mul_ps(lane_t, inverse));
+	_mm_storeu_ps(u, _mm_mul_ps(lane_u, inverse));
+	_mm_storeu_ps(v, _mm_mul_ps(lane_v, inverse));
+	return mask;
+#else
+	Triangle current{ };
+	current.a = { this->_component(X0)[index], this->_component(Y0)[index], this->_component(Z0)[index] };
+	current.e1 = { this->_component(E1X)[index], this->_component(E1Y)[index], this->_component(E1Z)[index] };
+	current.e2 = { this->_component(E2X)[index], this->_component(E2Y)[index], this->_component(E2Z)[index] };
+	Hit hit;
+	if (!current.intersect(from, ray, t_min, t_max, hit)) return 0;
+	t[0] = hit.t;
+	u[0] = hit.u;
+	v[0] = hit.v;
+	return 1;
+#endif
+}
+
+bool TriangleBuffer::closest(size_t first, size_t count,
+	const glm::vec3& from,
+	const glm::vec3& ray,
+	float t_min, float t_max,
+	Hit& hit) const {
+	bool collided{ false };
+	float t[8], u[8], v[8];
+	for (size_t index{ first }; index < first + count; index += width) {
+		int mask{ this->_test(index, from, ray, t_min, t_max, t, u, v) };
+		if (first + count - index < width) {
+			mask &= (1 << (first + count - index)) - 1;
+		}
+		for (size_t lane{ 0 }; lane < width; lane++) {
+			if ((mask & (1 << lane)) == 0 || t[lane] >= t_max) continue;
+			collided = true;
+			t_max = t[lane];
+			hit.t = t[lane];
+			hit.u = u[lane];
+			hit.v = v[lane];
+			hit.triangle = index + lane;
+		}
+	}
+	return collided;
+}
+bool TriangleBuffer::any(size_t first, size_t count,
+	const glm::vec3& from,
+	const glm::vec3& ray,
+	float t_min, float t_max,
+	size_t ignore) const {
+	float t[8], u[8], v[8];
+	for (size_t index{ first }; index < first + count; index += width) {
+		int mask{ this->_test(index, from, ray, t_min, t_max, t, u, v) };
+		if (first + count - index < width) {
+			mask &= (1 << (first + count - index)) - 1;
+		}
+		if (ignore >= index && ignore < index + width) {
+			mask &= ~(1 << (ignore - index));
+		}
+		if (mask) return true;
+	}
+	return false;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "triangle.hpp"
+
+// Structure-of-arrays copy of the scene's triangles, one array per
+// component, padded so a batch of triangles is one load from any index,
+// leaves start anywhere so the loads are unaligned
+class TriangleBuffer {
+private:
+
+	enum Component { X0, Y0, Z0, E1X, E1Y, E1Z, E2X, E2Y, E2Z, COMPONENTS };
+
+	size_t total{ 0 };
+	size_t stride{ 0 };
+	std::vector<float> storage{ };
+
+	const float* _component(Component component) const;
+	int _test(size_t index,
+		const glm::vec3& from,
+		const glm::vec3& ray,
+		float t_min, float t_max,
+		float* t, float* u, float* v) const;
+
+public:
+
+	static const size_t width;
+
+	void build(const std::vector<Triangle>& triangles);
+	size_t memory() const;
+
+	bool closest(size_t first, size_t count,
+		const glm::vec3& from,
+		const glm::vec3& ray,
+		float t_min, float t_max,
+		Hit& hit) const;
+	bool any(size_t first, size_t count,
+		const glm::vec3& from,
+		const glm::vec3& ray,
+		float t_min, float t_max,
+		size_t ignore) const;
+
+};
@@ -0,0 +1,316 @@
+#include "bvh.hpp"
+
+#include <limits>
+#include <utility>
+#include <algorithm>
+
+void BVH::build(const std::vector<std::pair<Object, float>>& objects) {
+	triangles.clear();
+	nodes.clear();
+	buffer.build(triangles);
+	for (size_t o{ 0 }; o < objects.size(); o++) {
+		const std::vector<Element>& elements{ objects.at(o).first.getElements() };
+		for (size_t e{ 0 }; e < elements.size(); e++) {
+			const Element& elem{ elements.at(e) };
+			for (size_t f{ 0 }; f < elem.faces.size(); f++) {
+				const Face& face{ elem.faces.at(f) };
+				triangles.push_back({ o, e, f,
+					elem.points.at(face.a),
+					elem.points.at(face.b),
+					elem.points.at(face.c) });
+			}
+		}
+	}
+	if (triangles.empty()) return;
+
+	// A binary tree over n leaves never has more than 2n - 1 nodes,
+	// so reserving up front keeps node references stable while splitting
+	nodes.reserve(2 * triangles.size());
+	nodes.push_back({ { }, { }, 0, triangles.size() });
+	this->_split(0, 0);
+	buffer.build(triangles);
+}
+
+void BVH::_bound(Node& node) {
+	node.min = glm::vec3{ std::numeric_limits<float>::max() };
+	node.max = glm::vec3{ -std::numeric_limits<float>::max() };
+	for (size_t i{ node.first }; i < node.first + node.count; i++) {
+		const Triangle& t{ triangles.at(i) };
+		node.min = glm::min(node.min, glm::min(t.a, glm::min(t.b(), t.c())));
+		node.max = glm::max(node.max, glm::max(t.a, glm::max(t.b(), t.c())));
+	}
+}
+float BVH::_area(const glm::vec3& min, const glm::vec3& max) const {
+	const glm::vec3 d{ max - min };
+	return 2.0f * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+}
+void BVH::_split(size_t index, size_t depth) {
+	Node& node{ nodes.at(index) };
+	this->_bound(node);
+	if (node.count <= leaf_size || depth + 2 >= stack_size) return;
+
+	glm::vec3 cmin{ std::numeric_limits<float>::max() };
+	glm::vec3 cmax{ -std::numeric_limits<float>::max() };
+	for (size_t i{ node.first }; i < node.first + node.count; i++) {
+		const Triangle& t{ triangles.at(i) };
+		const glm::vec3 centroid{ t.point(1 / 3.0f, 1 / 3.0f) };
+		cmin = glm::min(cmin, centroid);
+		cmax = glm::max(cmax, centroid);
+	}
+
+	// Binned surface area heuristic, every axis is tried and the
+	// cheapest split plane between two bins is kept
+	struct Bin {
+		glm::vec3 min{ std::numeric_limits<float>::max() };
+		glm::vec3 max{ -std::numeric_limits<float>::max() };
+		size_t count{ 0 };
+	};
+	float best_cost{ std::numeric_limits<float>::max() };
+	int best_axis{ -1 };
+	size_t best_bin{ 0 };
+	for (int axis{ 0 }; axis < 3; axis++) {
+		const float extent{ cmax[axis] - cmin[axis] };
+		if (extent <= 0) continue;
+		Bin binned[bins];
+		for (size_t i{ node.first }; i < node.first + node.count; i++) {
+			const Triangle& t{ triangles.at(i) };
+			const float centroid{ t.point(1 / 3.0f, 1 / 3.0f)[axis] };
+			Bin& bin{ binned[std::min(bins - 1, static_cast<size_t>(
+				bins * (centroid - cmin[axis]) / extent))] };
+			bin.min = glm::min(bin.min, glm::min(t.a, glm::min(t.b(), t.c())));
+			bin.max = glm::max(bin.max, glm::max(t.a, glm::max(t.b(), t.c())));
+			bin.count++;
+		}
+
+		float right_area[bins];
+		size_t right_count[bins];
+		Bin right{ };
+		for (size_t b{ bins - 1 }; b > 0; b--) {
+			right.min = glm::min(right.min, binned[b].min);
+			right.max = glm::max(right.max, binned[b].max);
+			right.count += binned[b].count;
+			right_area[b] = this->_area(right.min, right.max);
+			right_count[b] = right.count;
+		}
+		Bin left{ };
+		for (size_t b{ 1 }; b < bins; b++) {
+			left.min = glm::min(left.min, binned[b - 1].min);
+			left.max = glm::max(left.max, binned[b - 1].max);
+			left.count += binned[b - 1].count;
+			if (left.count == 0 || right_count[b] == 0) continue;
+			const float cost{ left.count * this->_area(left.min, left.max)
+				+ right_count[b] * right_area[b] };
+			if (cost < best_cost) {
+				best_cost = cost;
+				best_axis = axis;
+				best_bin = b;
+			}
+		}
+	}
+	if (best_axis < 0) return;
+	if (best_cost >= node.count * this->_area(node.min, node.max)) return;
+
+	const float extent{ cmax[best_axis] - cmin[best_axis] };
+	auto middle{ std::partition(
+		triangles.begin() + node.first,
+		triangles.begin() + node.first + node.count,
+		[&](const Triangle& t) {
+			const float centroid{ t.point(1 / 3.0f, 1 / 3.0f)[best_axis] };
+			return std::min(bins - 1, static_cast<size_t>(
+				bins * (centroid - cmin[best_axis]) / extent)) < best_bin;
+		}
+	) };
+	const size_t left_count{ static_cast<size_t>(
+		middle - (triangles.begin() + node.first)) };
+	if (left_count == 0 || left_count == node.count) return;
+
+	const size_t child{ nodes.size() };
+	nodes.push_back({ { }, { }, node.first, left_count });
+	nodes.push_back({ { }, { }, node.first + left_count, node.count - left_count });
+	node.first = child;
+	node.count = 0;
+	this->_split(child, depth + 1);
+	this->_split(child + 1, depth + 1);
+}
+
+bool BVH::_hitBox(const Node& node,
+	const glm::vec3& from,
+	const glm::vec3& inverse_ray,
+	float t_max, float& t_near) const {
+	const glm::vec3 t0{ (node.min - from) * inverse_ray };
+	const glm::vec3 t1{ (node.max - from) * inverse_ray };
+	const glm::vec3 lower{ glm::min(t0, t1) };
+	const glm::vec3 upper{ glm::max(t0, t1) };
+	t_near = std::max(std::max(lower[0], lower[1]), lower[2]);
+	const float t_far{ std::min(std::min(upper[0], upper[1]), upper[2]) };
+	return t_near <= t_far && t_far >= 0 && t_near <= t_max;
+}
+bool BVH::closest(const glm::vec3& from,
+	const glm::vec3& ray,
+	Hit& hit) const {
+	if (nodes.empty()) return false;
+	return this->_closest(0, from, ray,
+		std::numeric_limits<float>::infinity(), hit);
+}
+bool BVH::_closest(size_t root,
+	const glm::vec3& from,
+	const glm::vec3& ray,
+	float t_max, Hit& hit) const {
+	const glm::vec3 inverse_ray{ 1.0f / ray };
+
+	bool collided{ false };
+	float t_near{ 0 };
+	if (!this->_hitBox(nodes[root], from, inverse_ray, t_max, t_near)) return false;
+
+	std::pair<size_t, float> stack[stack_size];
+	size_t top{ 0 };
+	stack[top++] = { root, t_near };
+	while (top > 0) {
+		const auto entry{ stack[--top] };
+		if (entry.second > t_max) continue;
+		const Node& node{ nodes[entry.first] };
+		if (node.count > 0) {
+			if (buffer.closest(node.first, node.count, from, ray, 0, t_max, hit)) {
+				collided = true;
+				t_max = hit.t;
+			}
+			continue;
+		}
+
+		// The nearer child goes on top so it is visited first
+		float t_left, t_right;
+		const bool left{ this->_hitBox(nodes[node.first],
+			from, inverse_ray, t_max, t_left) };
+		const bool right{ this->_hitBox(nodes[node.first + 1],
+			from, inverse_ray, t_max, t_right) };
+		if (left && right) {
+			if (t_left < t_right) {
+				stack[top++] = { node.first + 1, t_right };
+				stack[top++] = { node.first, t_left };
+			} else {
+				stack[top++] = { node.first, t_left };
+				stack[top++] = { node.first + 1, t_right };
+			}
+		} else if (left) {
+			stack[top++] = { node.first, t_left };
+		} else if (right) {
+			stack[top++] = { node.first + 1, t_right };
+		}
+	}
+	return collided;
+}
+void BVH::closest(RayPacket& packet) const {
+	if (nodes.empty() || packet.active == 0) return;
+
+	if (!packet.coherent()) {
+		for (int lane{ 0 }; lane < RayPacket::size; lane++) {
+			if ((packet.active & (1 << lane)) == 0) continue;
+			Hit hit;
+			if (!this->closest(packet.from, packet.ray(lane), hit)) continue;
+			packet.t[lane] = hit.t;
+			packet.u[lane] = hit.u;
+			packet.v[lane] = hit.v;
+			packet.triangle[lane] = hit.triangle;
+			packet.hits |= 1 << lane;
+		}
+		return;
+	}
+
+	struct Entry {
+		size_t node{ 0 };
+		int mask{ 0 };
+		float t_near{ 0 };
+	};
+	Entry stack[stack_size];
+	size_t top{ 0 };
+	float t_near;
+	const int mask{ packet.hitBox(nodes.front().min,
+		nodes.front().max, packet.active, t_near) };
+	if (mask == 0) return;
+	stack[top++] = { 0, mask, t_near };
+	while (top > 0) {
+		const Entry entry{ stack[--top] };
+		float t_far{ 0 };
+		for (int lane{ 0 }; lane < RayPacket::size; lane++) {
+			if (entry.mask & (1 << lane)) t_far = std::max(t_far, packet.t[lane]);
+		}
+		if (entry.t_near > t_far) continue;
+		const Node& node{ nodes[entry.node] };
+
+		// Once only one ray still wants this subtree the packet has
+		// diverged, so that ray finishes it with the scalar traversal
+		if ((entry.mask & (entry.mask - 1)) == 0) {
+			int lane{ 0 };
+			while ((entry.mask & (1 << lane)) == 0) lane++;
+			Hit hit;
+			if (this->_closest(entry.node, packet.from, packet.ray(lane),
+				packet.t[lane], hit)) {
+				packet.t[lane] = hit.t;
+				packet.u[lane] = hit.u;
+				packet.v[lane] = hit.v;
+				packet.triangle[lane] = hit.triangle;
+				packet.hits |= entry.mask;
+			}
+			continue;
+		}
+		if (node.count > 0) {
+			packet.intersect(triangles, node.first, node.count, entry.mask);
+			continue;
+		}
+
+		float t_left, t_right;
+		const int left{ packet.hitBox(nodes[node.first].min,
+			nodes[node.first].max, entry.mask, t_left) };
+		const int right{ packet.hitBox(nodes[node.first + 1].min,
+			nodes[node.first + 1].max, entry.mask, t_right) };
+		if (left && right) {
+			if (t_left < t_right) {
+				stack[top++] = { node.first + 1, right, t_right };
+				stack[top++] = { node.first, left, t_left };
+			} else {
+				stack[top++] = { node.first, left, t_left };
+				stack[top++] = { node.first + 1, right, t_right };
+			}
+		} else if (left) {
+			stack[top++] = { node.first, left, t_left };
+		} else if (right) {
+			stack[top++] = { node.first + 1, right, t_right };
+		}
+	}
+}
+bool BVH::occluded(const glm::vec3& from,
+	const glm::vec3& ray,
+	float t_min, float t_max,
+	size_t ignore) const {
+	if (nodes.empty()) return false;
+	const glm::vec3 inverse_ray{ 1.0f / ray };
+
+	size_t stack[stack_size];
+	size_t top{ 0 };
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node& node{ nodes[stack[--top]] };
+		float t_near;
+		if (!this->_hitBox(node, from, inverse_ray, t_max, t_near)) continue;
+		if (node.count > 0) {
+			if (buffer.any(node.first, node.count,
+				from, ray, t_min, t_max, ignore)) return true;
+			continue;
+		}
+		stack[top++] = node.first;
+		stack[top++] = node.first + 1;
+	}
+	return false;
+}
+
+const Triangle& BVH::getTriangle(size_t index) const {
+	return triangles.at(index);
+}
+size_t BVH::getTriangleCount() const {
+	return triangles.size();
+}
+size_t BVH::memory() const {
+	return triangles.capacity() * sizeof(Triangle)
+		+ nodes.capacity() * sizeof(Node)
+		+ buffer.memory();
+}
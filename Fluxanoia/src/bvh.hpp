@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "object.hpp"
+#include "buffer.hpp"
+#include "packet.hpp"
+#include "triangle.hpp"
+
+class BVH {
+private:
+
+	static const size_t bins{ 12 };
+	static const size_t leaf_size{ 2 };
+	static const size_t stack_size{ 64 };
+
+	// Interior nodes have count == 0 and their children at
+	// first and first + 1, leaves own triangles [first, first + count)
+	struct Node {
+		glm::vec3 min{ }, max{ };
+		size_t first{ 0 }, count{ 0 };
+	};
+
+	// Triangles are kept twice in the same order, the structures carry
+	// the ids and normal that shading looks up through getTriangle and
+	// feed the packet leaves, which test one triangle against four rays,
+	// while the buffer only holds the vertex and edges the single ray
+	// leaves test several triangles at a time from
+	std::vector<Triangle> triangles{ };
+	std::vector<Node> nodes{ };
+	TriangleBuffer buffer{ };
+
+	void _bound(Node& node);
+	void _split(size_t index, size_t depth);
+	float _area(const glm::vec3& min, const glm::vec3& max) const;
+
+	bool _hitBox(const Node& node,
+		const glm::vec3& from,
+		const glm::vec3& inverse_ray,
+		float t_max, float& t_near) const;
+	bool _closest(size_t root,
+		const glm::vec3& from,
+		const glm::vec3& ray,
+		float t_max, Hit& hit) const;
+
+public:
+
+	void build(const std::vector<std::pair<Object, float>>& objects);
+
+	bool closest(const glm::vec3& from,
+		const glm::vec3& ray,
+		Hit& hit) const;
+	void closest(RayPacket& packet) const;
+	bool occluded(const glm::vec3& from,
+		const glm::vec3& ray,
+		float t_min, float t_max,
+		size_t ignore) const;
+
+	const Triangle& getTriangle(size_t index) const;
+	size_t getTriangleCount() const;
+	size_t memory() const;
+
+};
@@ -0,0 +1,163 @@
+#include "clip.hpp"
+
+#include <algorithm>
+
+#include "halfspace.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLIP_SSE
+#include <emmintrin.h>
+#endif
+
+Render::Clipper::Clipper(size_t width, size_t height, float scale)
+	: scale{ scale },
+	centre_x{ static_cast<float>(width / 2) },
+	centre_y{ static_cast<float>(height / 2) } {
+	// The band matches the half-space rasteriser's so every clipped
+	// triangle can be set up there, unless the window outgrows it
+	guard = std::max({ static_cast<float>(HalfSpace::guard - 1),
+		centre_x + 1, centre_y + 1 });
+}
+
+void Render::Clipper::transform(const glm::mat4& view,
+	const std::vector<glm::vec3>& points,
+	std::vector<glm::vec3>& camera,
+	std::vector<glm::vec3>& out) const {
+	camera.resize(points.size());
+	out.resize(points.size());
+
+	// The last few points go through the same batch as the rest, padded
+	// out with copies, so every point is projected identically
+	const size_t whole{ points.size() / 4 * 4 };
+	this->_transform(view, points.data(), whole, camera.data(), out.data());
+	if (whole == points.size()) return;
+	glm::vec3 tail[4], tail_camera[4], tail_out[4];
+	for (size_t i{ 0 }; i < 4; i++) tail[i] = points[std::min(whole + i, points.size() - 1)];
+	this->_transform(view, tail, 4, tail_camera, tail_out);
+	std::copy(tail_camera, tail_camera + points.size() - whole, camera.begin() + whole);
+	std::copy(tail_out, tail_out + points.size() - whole, out.begin() + whole);
+}
+void Render::Clipper::_transform(const glm::mat4& view,
+	const glm::vec3* points, size_t count,
+	glm::vec3* camera, glm::vec3* out) const {
+	// Four points at a time, their coordinates are swizzled into one
+	// register per axis, moved by the combined camera matrix and then
+	// divided through, clipped corners pass an identity matrix
+#ifdef CLIP_SSE
+	__m128 m[4][3];
+	for (size_t c{ 0 }; c < 4; c++) {
+		for (size_t r{ 0 }; r < 3; r++) m[c][r] = _mm_set1_ps(view[c][r]);
+	}
+	const __m128 s{ _mm_set1_ps(scale) };
+	const __m128 cx{ _mm_set1_ps(centre_x) };
+	const __m128 cy{ _mm_set1_ps(centre_y) };
+	const __m128 minus_one{ _mm_set1_ps(-1.0f) };
+	for (size_t i{ 0 }; i < count; i += 4) {
+		const float* p{ &points[i][0] };
+		const __m128 a{ _mm_loadu_ps(p) };
+		const __m128 b{ _mm_loadu_ps(p + 4) };
+		const __m128 c{ _mm_loadu_ps(p + 8) };
+		const __m128 x{ _mm_shuffle_ps(a,
+			_mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0)) };
+		const __m128 y{ _mm_shuffle_ps(
+			_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+			_mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)) };
+		const __m128 z{ _mm_shuffle_ps(
+			_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), c, _MM_SHUFFLE(3, 0, 2, 0)) };
+
+		__m128 v[3];
+		for (size_t r{ 0 }; r < 3; r++) {
+			v[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][r], x), _mm_mul_ps(m[1][r], y)),
+				_mm_add_ps(_mm_mul_ps(m[2][r], z), m[3][r]));
+		}
+		const __m128 depth{ _mm_div_ps(minus_one, v[2]) };
+		const __m128 sx{ _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, v[0]), depth), cx) };
+		const __m128 sy{ _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, v[1]), depth), cy) };
+
+		float lanes[6][4];
+		_mm_storeu_ps(lanes[0], v[0]);
+		_mm_storeu_ps(lanes[1], v[1]);
+		_mm_storeu_ps(lanes[2], v[2]);
+		_mm_storeu_ps(lanes[3], sx);
+		_mm_storeu_ps(lanes[4], sy);
+		_mm_storeu_ps(lanes[5], depth);
+		for (size_t lane{ 0 }; lane < 4; lane++) {
+			camera[i + lane] = { lanes[0][lane], lanes[1][lane], lanes[2][lane] };
+			out[i + lane] = { lanes[3][lane], lanes[4][lane], lanes[5][lane] };
+		}
+	}
+#else
+	for (size_t i{ 0 }; i < count; i++) {
+		const glm::vec3 p{ view * glm::vec4{ points[i], 1.0f } };
+		const float depth{ -1.0f / p[2] };
+		camera[i] = p;
+		out[i] = { scale * p[0] * depth + centre_x,
+			scale * p[1] * depth + centre_y, depth };
+	}
+#endif
+}
+float Render::Clipper::_distance(const glm::vec3& p, size_t plane) const {
+	// With w = -z a point projects to x = scale * x / w + centre_x, so
+	// each side of the band is a plane through the camera
+	switch (plane) {
+	case 0: return -p[2] - near;
+	case 1: return scale * p[0] - guard * p[2];
+	case 2: return -scale * p[0] - guard * p[2];
+	case 3: return scale * p[1] - guard * p[2];
+	default: return -scale * p[1] - guard * p[2];
+	}
+}
+uint8_t Render::Clipper::outcode(const glm::vec3& p) const {
+	uint8_t code{ 0 };
+	for (size_t plane{ 0 }; plane < planes; plane++) {
+		if (!(this->_distance(p, plane) >= 0)) code |= 1 << plane;
+	}
+	return code;
+}
+
+size_t Render::Clipper::clip(const ClipVertex (&triangle)[3],
+	CanvasTriangle (&out)[fan]) const {
+	// Sutherland-Hodgman, each plane adds at most one corner
+	ClipVertex buffers[2][most];
+	ClipVertex* polygon{ buffers[0] };
+	ClipVertex* next{ buffers[1] };
+	size_t count{ 3 };
+	std::copy(triangle, triangle + 3, polygon);
+	for (size_t plane{ 0 }; plane < planes && count > 0; plane++) {
+		size_t kept{ 0 };
+		for (size_t i{ 0 }; i < count; i++) {
+			const ClipVertex& a{ polygon[i] };
+			const ClipVertex& b{ polygon[(i + 1) % count] };
+			const float d_a{ this->_distance(a.position, plane) };
+			const float d_b{ this->_distance(b.position, plane) };
+			if (d_a >= 0) next[kept++] = a;
+			if ((d_a >= 0) != (d_b >= 0)) {
+				const float t{ d_a / (d_a - d_b) };
+				next[kept++] = {
+					a.position + t * (b.position - a.position),
+					a.texture + t * (b.texture - a.texture) };
+			}
+		}
+		std::swap(polygon, next);
+		count = kept;
+	}
+	if (count < 3) return 0;
+
+	// Corners are projected through the same batches as the scene's
+	// points, so a corner the planes left alone lands where it did for
+	// the neighbouring unclipped triangles
+	glm::vec3 positions[most + 3], camera[most + 3], projected[most + 3];
+	for (size_t i{ 0 }; i < count; i++) positions[i] = polygon[i].position;
+	this->_transform(glm::mat4{ 1.0f }, positions,
+		(count + 3) / 4 * 4, camera, projected);
+	CanvasPoint points[most];
+	for (size_t i{ 0 }; i < count; i++) {
+		const glm::vec3& p{ projected[i] };
+		points[i] = { p[0], p[1], p[2] };
+		points[i].texturePoint = { polygon[i].texture[0], polygon[i].texture[1] };
+	}
+	for (size_t i{ 2 }; i < count; i++) {
+		out[i - 2] = { points[0], points[i - 1], points[i] };
+	}
+	return count - 2;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+#include <CanvasPoint.h>
+#include <CanvasTriangle.h>
+
+namespace Render {
+
+	// A triangle corner before projection, in camera space where the
+	// camera looks down -z, along with its texture coordinate
+	struct ClipVertex {
+		glm::vec3 position{ };
+		glm::vec2 texture{ };
+	};
+
+	// Transforms and projects points onto the window and clips triangles
+	// to the near plane and a guard band around the window, the planes
+	// are linear in camera space so clipping there is clipping in
+	// homogeneous space, triangles inside every plane are left alone
+	class Clipper {
+	private:
+
+		static const size_t planes{ 5 };
+		static const size_t most{ 3 + planes };
+
+		float scale{ 1 };
+		float centre_x{ 0 }, centre_y{ 0 };
+		float guard{ 0 };
+		const float near{ 0.01f };
+
+		float _distance(const glm::vec3& position, size_t plane) const;
+		void _transform(const glm::mat4& view,
+			const glm::vec3* points, size_t count,
+			glm::vec3* camera, glm::vec3* out) const;
+
+	public:
+
+		// A triangle cut by every plane becomes a fan of this many
+		static const size_t fan{ most - 2 };
+
+		Clipper(size_t width, size_t height, float scale);
+
+		void transform(const glm::mat4& view,
+			const std::vector<glm::vec3>& points,
+			std::vector<glm::vec3>& camera,
+			std::vector<glm::vec3>& out) const;
+		uint8_t outcode(const glm::vec3& position) const;
+		size_t clip(const ClipVertex (&triangle)[3],
+			CanvasTriangle (&out)[fan]) const;
+	};
+
+};
@@ -0,0 +1,58 @@
+#include "depth.hpp"
+
+#include <algorithm>
+
+void Render::DepthBuffer::reset(size_t width, size_t height) {
+	this->width = width;
+	this->height = height;
+	blocks_x = (width + block - 1) / block;
+	blocks_y = (height + block - 1) / block;
+	values.assign(width * height, 0);
+	blocks.assign(blocks_x * blocks_y, 0);
+	dirty.assign(blocks_x * blocks_y, 0);
+}
+
+float* Render::DepthBuffer::data() {
+	return values.data();
+}
+size_t Render::DepthBuffer::getWidth() const {
+	return width;
+}
+
+float Render::DepthBuffer::farthest(size_t bx, size_t by) {
+	const size_t index{ bx + blocks_x * by };
+	if (dirty[index] >= regather) {
+		const size_t x_max{ std::min((bx + 1) * block, width) };
+		const size_t y_max{ std::min((by + 1) * block, height) };
+		float value{ values[bx * block + width * by * block] };
+		for (size_t y{ by * block }; y < y_max; y++) {
+			for (size_t x{ bx * block }; x < x_max; x++) {
+				value = std::min(value, values[x + width * y]);
+			}
+		}
+		blocks[index] = value;
+		dirty[index] = 0;
+	}
+	return blocks[index];
+}
+bool Render::DepthBuffer::hidden(size_t x_min, size_t y_min,
+	size_t x_max, size_t y_max,
+	float nearest) {
+	if (x_min >= x_max || y_min >= y_max) return false;
+	for (size_t by{ y_min / block }; by <= (y_max - 1) / block; by++) {
+		for (size_t bx{ x_min / block }; bx <= (x_max - 1) / block; bx++) {
+			if (!(this->farthest(bx, by) > nearest)) return false;
+		}
+	}
+	return true;
+}
+void Render::DepthBuffer::touch(size_t x_min, size_t y_min,
+	size_t x_max, size_t y_max) {
+	if (x_min >= x_max || y_min >= y_max) return;
+	for (size_t by{ y_min / block }; by <= (y_max - 1) / block; by++) {
+		for (size_t bx{ x_min / block }; bx <= (x_max - 1) / block; bx++) {
+			uint8_t& count{ dirty[bx + blocks_x * by] };
+			if (count < regather) count++;
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace Render {
+
+	// A full resolution depth buffer with a conservative depth for
+	// every 8x8 block of it, depths grow towards the camera from 0 so
+	// a block keeps the smallest depth stored in it, and anything
+	// further away than that is hidden everywhere in the block
+	class DepthBuffer {
+	private:
+
+		size_t width{ 0 }, height{ 0 };
+		size_t blocks_x{ 0 }, blocks_y{ 0 };
+		std::vector<float> values{ };
+
+		// Blocks count the triangles drawn into them since their depth
+		// was last gathered, the stored depth is then only a lower bound
+		// and it is gathered again once enough have gone by that it is
+		// worth scanning the block for
+		const uint8_t regather{ 4 };
+		std::vector<float> blocks{ };
+		std::vector<uint8_t> dirty{ };
+
+	public:
+
+		static const size_t block{ 8 };
+
+		void reset(size_t width, size_t height);
+
+		float* data();
+		size_t getWidth() const;
+
+		float farthest(size_t bx, size_t by);
+		bool hidden(size_t x_min, size_t y_min,
+			size_t x_max, size_t y_max,
+			float nearest);
+		void touch(size_t x_min, size_t y_min,
+			size_t x_max, size_t y_max);
+	};
+
+};
@@ -0,0 +1,188 @@
+#include "halfspace.hpp"
+#include "render.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HALFSPACE_SSE
+#include <emmintrin.h>
+#endif
+
+bool Render::_setupHalfSpace(const Target& target,
+	CanvasTriangle triangle,
+	HalfSpace& half_space) {
+	const int origin_x{ static_cast<int>(target.width / 2) };
+	const int origin_y{ static_cast<int>(target.height / 2) };
+
+	int64_t x[3], y[3];
+	for (size_t i{ 0 }; i < 3; i++) {
+		const float dx{ triangle[i].x - origin_x };
+		const float dy{ triangle[i].y - origin_y };
+		if (!(std::abs(dx) <= HalfSpace::guard)
+			|| !(std::abs(dy) <= HalfSpace::guard)) return false;
+		x[i] = std::lround(dx * HalfSpace::subpixel);
+		y[i] = std::lround(dy * HalfSpace::subpixel);
+	}
+
+	// Winding is made consistent so the inside of every edge is
+	// positive, whichever way the triangle faced on screen
+	int64_t area{ (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]) };
+	if (area == 0) return true;
+	if (area < 0) {
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+		std::swap(triangle[1], triangle[2]);
+		area = -area;
+	}
+
+	// The bounding box is clipped to the target, the edge values are
+	// exact so a clipped triangle covers the same pixels it would have
+	half_space.x_min = std::max(static_cast<int>(target.x_min),
+		static_cast<int>(std::floor(std::min(
+		{ triangle[0].x, triangle[1].x, triangle[2].x }))));
+	half_space.y_min = std::max(static_cast<int>(target.y_min),
+		static_cast<int>(std::floor(std::min(
+		{ triangle[0].y, triangle[1].y, triangle[2].y }))));
+	half_space.x_max = std::min(static_cast<int>(target.x_max) - 1,
+		static_cast<int>(std::ceil(std::max(
+			{ triangle[0].x, triangle[1].x, triangle[2].x }))));
+	half_space.y_max = std::min(static_cast<int>(target.y_max) - 1,
+		static_cast<int>(std::ceil(std::max(
+			{ triangle[0].y, triangle[1].y, triangle[2].y }))));
+
+	const int64_t sample_x{ (half_space.x_min - origin_x) * HalfSpace::subpixel
+		+ HalfSpace::subpixel / 2 };
+	const int64_t sample_y{ (half_space.y_min - origin_y) * HalfSpace::subpixel
+		+ HalfSpace::subpixel / 2 };
+	for (size_t i{ 0 }; i < 3; i++) {
+		const size_t j{ (i + 1) % 3 };
+		const int64_t a{ y[i] - y[j] };
+		const int64_t b{ x[j] - x[i] };
+
+		// Top-left fill rule, pixel centres exactly on an edge only
+		// belong to the triangle when it is a top or a left edge
+		const bool top_left{ a > 0 || (a == 0 && b > 0) };
+		half_space.a[i] = static_cast<int32_t>(a * HalfSpace::subpixel);
+		half_space.b[i] = static_cast<int32_t>(b * HalfSpace::subpixel);
+		half_space.c[i] = static_cast<int32_t>(
+			a * (sample_x - x[i]) + b * (sample_y - y[i]));
+		half_space.threshold[i] = top_left ? -1 : 0;
+
+		const size_t k{ (i + 2) % 3 };
+		half_space.depth[i] = triangle[k].depth / area;
+		half_space.u[i] = triangle[k].texturePoint.x / area;
+		half_space.v[i] = triangle[k].texturePoint.y / area;
+	}
+	half_space.nearest = Render::_nearest(triangle);
+	return true;
+}
+
+void Render::_drawHalfSpace(Target& target,
+	const HalfSpace& half_space,
+	uint32_t colour,
+	const Sampler* map) {
+	const int block{ HalfSpace::block };
+	const int x_start{ half_space.x_min - half_space.x_min % block };
+	const int y_start{ half_space.y_min - half_space.y_min % block };
+
+	for (int by{ y_start }; by <= half_space.y_max; by += block) {
+		for (int bx{ x_start }; bx <= half_space.x_max; bx += block) {
+			// Edge values at the four corner pixels decide whether the
+			// block is skipped, filled without tests or tested per pixel
+			int32_t row[3];
+			bool covered{ true }, empty{ false };
+			for (size_t i{ 0 }; i < 3; i++) {
+				row[i] = half_space.c[i]
+					+ half_space.a[i] * (bx - half_space.x_min)
+					+ half_space.b[i] * (by - half_space.y_min);
+				const int32_t across{ half_space.a[i] * (block - 1) };
+				const int32_t down{ half_space.b[i] * (block - 1) };
+				const int32_t corners[4]{ row[i], row[i] + across,
+					row[i] + down, row[i] + across + down };
+				int inside{ 0 };
+				for (int32_t corner : corners) {
+					if (corner > half_space.threshold[i]) inside++;
+				}
+				if (inside == 0) empty = true;
+				if (inside < 4) covered = false;
+			}
+			if (empty) continue;
+
+			const int x_end{ std::min(bx + block - 1, half_space.x_max) };
+			const int y_end{ std::min(by + block - 1, half_space.y_max) };
+
+			// Blocks line up with those of the hierarchical depth, so a
+			// block behind its stored depth is skipped whole
+			if (target.hiz != nullptr && target.hiz->farthest(bx / DepthBuffer::block,
+				by / DepthBuffer::block) > half_space.nearest) {
+				target.culled_pixels += (x_end - std::max(bx, half_space.x_min) + 1)
+					* (y_end - std::max(by, half_space.y_min) + 1);
+				continue;
+			}
+			for (int py{ std::max(by, half_space.y_min) }; py <= y_end; py++) {
+				int32_t e[3];
+				for (size_t i{ 0 }; i < 3; i++) {
+					e[i] = row[i] + half_space.b[i] * (py - by);
+				}
+				for (int px{ bx }; px <= x_end; px += 4) {
+					alignas(16) float depths[4], us[4], vs[4];
+					int mask{ 0 };
+#ifdef HALFSPACE_SSE
+					__m128 z{ _mm_setzero_ps() }, u{ z }, v{ z };
+					__m128i inside{ _mm_set1_epi32(-1) };
+					for (size_t i{ 0 }; i < 3; i++) {
+						const int32_t step{ half_space.a[i] };
+						const int32_t base{ e[i] + step * (px - bx) };
+						const __m128i lanes{ _mm_setr_epi32(base,
+							base + step, base + 2 * step, base + 3 * step) };
+						if (!covered) inside = _mm_and_si128(inside, _mm_cmpgt_epi32(
+							lanes, _mm_set1_epi32(half_space.threshold[i])));
+						const __m128 weight{ _mm_cvtepi32_ps(lanes) };
+						z = _mm_add_ps(z, _mm_mul_ps(weight, _mm_set1_ps(half_space.depth[i])));
+						u = _mm_add_ps(u, _mm_mul_ps(weight, _mm_set1_ps(half_space.u[i])));
+						v = _mm_add_ps(v, _mm_mul_ps(weight, _mm_set1_ps(half_space.v[i])));
+					}
+					mask = _mm_movemask_ps(_mm_castsi128_ps(inside));
+					_mm_store_ps(depths, z);
+					_mm_store_ps(us, u);
+					_mm_store_ps(vs, v);
+#else
+					for (int lane{ 0 }; lane < 4; lane++) {
+						bool inside{ true };
+						depths[lane] = us[lane] = vs[lane] = 0;
+						for (size_t i{ 0 }; i < 3; i++) {
+							const int32_t value{ e[i] + half_space.a[i] * (px + lane - bx) };
+							if (!covered && value <= half_space.threshold[i]) inside = false;
+							depths[lane] += value * half_space.depth[i];
+							us[lane] += value * half_space.u[i];
+							vs[lane] += value * half_space.v[i];
+						}
+						if (inside) mask |= 1 << lane;
+					}
+#endif
+					for (int lane{ 0 }; lane < 4; lane++) {
+						const int lane_x{ px + lane };
+						if ((mask & (1 << lane)) == 0) continue;
+						if (lane_x < half_space.x_min || lane_x > x_end) continue;
+						if (!target.test(lane_x, py, depths[lane])) continue;
+						if (map == nullptr) {
+							target.setPixel(lane_x, py, colour);
+							continue;
+						}
+						if (map->filter == TextureFilter::BILINEAR) {
+							target.setPixel(lane_x, py,
+								Render::_getBilinearColour(*map, us[lane], vs[lane]));
+							continue;
+						}
+						const int tx{ std::min(std::max(static_cast<int>(us[lane]), 0),
+							static_cast<int>(map->width) - 1) };
+						const int ty{ std::min(std::max(static_cast<int>(vs[lane]), 0),
+							static_cast<int>(map->height) - 1) };
+						target.setPixel(lane_x, py, map->pixels[map->index(tx, ty)]);
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <Colour.h>
+#include <CanvasTriangle.h>
+
+#include "target.hpp"
+#include "texture.hpp"
+
+namespace Render {
+
+	// One triangle set up for half-space rasterisation, the edge
+	// functions are fixed-point and measured from the middle of the
+	// window, so vertices have to lie within the guard band
+	struct HalfSpace {
+		static const int subpixel{ 16 };
+		static const int block{ 8 };
+		static const int guard{ 960 };
+
+		// Edge i runs from vertex i to vertex i + 1, c holds its value
+		// at the centre of pixel (x_min, y_min) and a, b its steps
+		// along a row and down a column
+		int32_t a[3]{ }, b[3]{ }, c[3]{ };
+		int32_t threshold[3]{ };
+		int x_min{ 0 }, y_min{ 0 }, x_max{ -1 }, y_max{ -1 };
+
+		// Attributes are planes over the edge values, edge i weights
+		// the vertex opposite to it
+		float depth[3]{ }, u[3]{ }, v[3]{ };
+		float nearest{ 0 };
+	};
+
+	bool _setupHalfSpace(const Target& target,
+		CanvasTriangle triangle,
+		HalfSpace& half_space);
+	void _drawHalfSpace(Target& target,
+		const HalfSpace& half_space,
+		uint32_t colour,
+		const Sampler* map);
+
+};
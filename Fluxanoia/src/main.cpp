@@ -1,10 +1,17 @@
 #include "main.hpp"
 
+#include <string>
+#include <thread>
+#include <stdexcept>
+#include <algorithm>
+
 #include "maths.hpp"
 #include "render.hpp"
 
-Main::Main(int width, int height) : width{ width }, height{ height } {
+Main::Main(int width, int height, size_t threads) : width{ width }, height{ height } {
 	window = DrawingWindow{ width, height, false };
+	scene.setThreads(threads);
+	scene.setProgressive(true);
 	//scene.loadObject("sphere.obj", 0.4f, 100);
 	scene.loadObject("textured-cornell-box.obj", 0.4f, 100);
 }
@@ -13,11 +20,17 @@ void Main::run() {
 	SDL_Event event;
 	running = true;
 	while (running) {
+		// Once the scene has nothing new to show the loop sleeps until
+		// an event arrives, waiting leaves the event queued for the poll
+		if (!scene.needsDraw()) SDL_WaitEvent(nullptr);
 		if (window.pollForInputEvents(event)) {
 			this->_handleEvent(event);
 		}
 		this->_update();
-		window.clearPixels();
+		if (!scene.needsDraw()) continue;
+
+		// Progressive passes refine the previous frame in place
+		if (!scene.isAccumulating()) window.clearPixels();
 		this->_draw();
 		window.renderFrame();
 	}
@@ -30,10 +43,15 @@ void Main::_draw() {
 void Main::_update() { }
 void Main::_handleEvent(SDL_Event e) { 
 	switch (e.type) {
+	case SDL_WINDOWEVENT:
+		// A window uncovered while idle shows the last frame again
+		if (e.window.event == SDL_WINDOWEVENT_EXPOSED) window.renderFrame();
+		break;
 	case SDL_KEYDOWN:
 		glm::vec3 v{ 0, 0, 0 };
 		glm::vec3 r{ 0, 0, 0 };
 		glm::vec3 o{ 0, 0, 0 };
+		glm::vec3 l{ 0, 0, 0 };
 		switch (e.key.keysym.sym) {
 		case SDLK_d:      v[0] -= tra_fac; break;
 		case SDLK_a:      v[0] += tra_fac; break;
@@ -56,14 +74,41 @@ void Main::_handleEvent(SDL_Event e) {
 		case SDLK_u: o[2] -= rot_fac; break;
 		case SDLK_o: o[2] += rot_fac; break;
 
+		case SDLK_f: l[0] -= tra_fac; break;
+		case SDLK_h: l[0] += tra_fac; break;
+		case SDLK_b: l[1] -= tra_fac; break;
+		case SDLK_y: l[1] += tra_fac; break;
+		case SDLK_t: l[2] -= tra_fac; break;
+		case SDLK_g: l[2] += tra_fac; break;
+		case SDLK_MINUS:  scene.setLightStrength(scene.getLightStrength() * 0.9f); break;
+		case SDLK_EQUALS: scene.setLightStrength(scene.getLightStrength() / 0.9f); break;
+
 		case SDLK_z: scene.setRenderMode(RenderMode::WIRE); break;
 		case SDLK_x: scene.setRenderMode(RenderMode::RASTER); break;
 		case SDLK_c: scene.setRenderMode(RenderMode::RAYTRACED); break;
+		case SDLK_e: scene.setRasteriser(
+			scene.getRasteriser() == Rasteriser::SCANLINE
+			? Rasteriser::HALFSPACE : Rasteriser::SCANLINE); break;
+		case SDLK_m: scene.setTextureLayout(
+			scene.getTextureLayout() == TextureLayout::LINEAR
+			? TextureLayout::TILED : TextureLayout::LINEAR); break;
+		case SDLK_q: scene.setMipmapping(!scene.getMipmapping()); break;
+		case SDLK_SEMICOLON: scene.setTextureFilter(
+			scene.getTextureFilter() == TextureFilter::NEAREST
+			? TextureFilter::BILINEAR : TextureFilter::NEAREST); break;
+		case SDLK_QUOTE: scene.setRasterLighting(!scene.getRasterLighting()); break;
+		case SDLK_SLASH: scene.setShading(
+			scene.getShading() == Shading::PHONG
+			? Shading::GOURAUD : Shading::PHONG); break;
+		case SDLK_p: scene.setPacketTracing(!scene.getPacketTracing()); break;
+		case SDLK_v: scene.setProgressive(!scene.getProgressive()); break;
+		case SDLK_n: scene.setAntialiasing(!scene.getAntialiasing()); break;
 
 		case SDLK_r: scene.lookAt({ 0, 0, 0 });
 		}
 		if (glm::length(v) != 0) scene.translate(v);
 		if (glm::length(o) != 0) scene.rotateCamera(o);
+		if (glm::length(l) != 0) scene.moveLight(l);
 		if (glm::length(r) != 0) {
 			scene.rotateWorld(r);
 			scene.lookAt({ 0, 0, 0 });
@@ -73,7 +118,17 @@ void Main::_handleEvent(SDL_Event e) {
 }
 
 int main(int n, char *args[]) {
-	Main m{ 512, 512 };
+	size_t threads{ std::max(1u, std::thread::hardware_concurrency()) };
+	for (int i{ 1 }; i + 1 < n; i++) {
+		if (std::string{ args[i] }.compare("--threads") == 0) {
+			// A count that cannot be read keeps the default
+			try {
+				threads = std::max(1ul, std::stoul(args[i + 1]));
+			} catch (const std::invalid_argument&) {
+			} catch (const std::out_of_range&) { }
+		}
+	}
+	Main m{ 512, 512, threads };
 	m.run();
 	return 0;
 }
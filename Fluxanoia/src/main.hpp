@@ -30,7 +30,7 @@ private:
 
 public:
 
-	Main(int width = 360, int height = 240);
+	Main(int width = 360, int height = 240, size_t threads = 1);
 	void run();
 
 };
@@ -84,6 +84,18 @@ std::vector<glm::vec3> Maths::interpolate3D(glm::vec3 start, glm::vec3 end, size
 	return interpolated;
 }
 
+Maths::Interpolator::Interpolator(float start, float end, size_t count)
+	: current{ start }, end{ end }, count{ count } {
+	if (count > 2) step = (end - start) / (count - 1);
+}
+float Maths::Interpolator::value() const {
+	return (count > 1 && index == count - 1) ? end : current;
+}
+void Maths::Interpolator::next() {
+	index++;
+	current += step;
+}
+
 glm::mat3 Maths::rotateX(float angle) {
 	return { 
 		glm::vec3(1.0f, 0.0f, 0.0f),
@@ -22,6 +22,17 @@ namespace Maths {
 	std::vector<glm::vec2> interpolate2D(glm::vec2 start, glm::vec2 end, size_t numValues);
 	std::vector<glm::vec3> interpolate3D(glm::vec3 start, glm::vec3 end, size_t numValues);
 
+	// Produces the values of interpolate one at a time, accumulating
+	// the step in the same order so the results match exactly
+	struct Interpolator {
+		float current{ 0 }, end{ 0 }, step{ 0 };
+		size_t index{ 0 }, count{ 0 };
+
+		Interpolator(float start, float end, size_t count);
+		float value() const;
+		void next();
+	};
+
 	glm::mat3 rotateX(float angle);
 	glm::mat3 rotateY(float angle);
 	glm::mat3 rotateZ(float angle);
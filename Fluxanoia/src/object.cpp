@@ -69,11 +69,21 @@ Object::Object(const std::string filename, const float scale) {
 	}
 	if (!element.name.empty()) elements.push_back(element);
 	for (Element& e : elements) {
+		// Vertex normals sum the unnormalised face normals, so each
+		// face is weighted by its area
+		e.normals.assign(e.points.size(), glm::vec3{ 0, 0, 0 });
 		for (Face& f : e.faces) {
-			f.normal = glm::normalize(glm::cross(
+			const glm::vec3 cross{ glm::cross(
 				e.points.at(f.b) - e.points.at(f.a),
 				e.points.at(f.c) - e.points.at(f.a)
-			));
+			) };
+			f.normal = glm::normalize(cross);
+			e.normals.at(f.a) += cross;
+			e.normals.at(f.b) += cross;
+			e.normals.at(f.c) += cross;
+		}
+		for (glm::vec3& n : e.normals) {
+			if (glm::dot(n, n) > 0) n = glm::normalize(n);
 		}
 	}
 	stream.close();
@@ -18,6 +18,7 @@ struct Element {
 	std::string name{ };
 	std::string mtl{ };
 	std::vector<glm::vec3> points{ };
+	std::vector<glm::vec3> normals{ };
 	std::vector<glm::vec2> texture_points{ };
 	std::vector<Face> faces{ };
 };
@@ -0,0 +1,184 @@
+#include "packet.hpp"
+
+#include <limits>
+#include <algorithm>
+
+#ifdef PACKET_SSE
+#include <emmintrin.h>
+#endif
+
+RayPacket::RayPacket(const glm::vec3& from) : from{ from } {
+	for (int lane{ 0 }; lane < size; lane++) {
+		t[lane] = std::numeric_limits<float>::infinity();
+	}
+}
+
+void RayPacket::add(int lane, const glm::vec3& ray) {
+	x[lane] = ray[0];
+	y[lane] = ray[1];
+	z[lane] = ray[2];
+	ix[lane] = 1.0f / ray[0];
+	iy[lane] = 1.0f / ray[1];
+	iz[lane] = 1.0f / ray[2];
+	t[lane] = std::numeric_limits<float>::infinity();
+	active |= 1 << lane;
+}
+glm::vec3 RayPacket::ray(int lane) const {
+	return { x[lane], y[lane], z[lane] };
+}
+Hit RayPacket::hit(int lane) const {
+	return { t[lane], u[lane], v[lane], triangle[lane] };
+}
+bool RayPacket::coherent() const {
+	// Rays whose directions share a sign on every axis visit the
+	// hierarchy in the same order, anything else is traced alone
+	int first{ -1 };
+	for (int lane{ 0 }; lane < size; lane++) {
+		if ((active & (1 << lane)) == 0) continue;
+		if (first < 0) {
+			first = lane;
+			continue;
+		}
+		if ((x[lane] < 0) != (x[first] < 0)) return false;
+		if ((y[lane] < 0) != (y[first] < 0)) return false;
+		if ((z[lane] < 0) != (z[first] < 0)) return false;
+	}
+	return true;
+}
+
+int RayPacket::hitBox(const glm::vec3& min,
+	const glm::vec3& max,
+	int mask, float& t_near) const {
+	alignas(16) float lower[size];
+	int result{ 0 };
+#ifdef PACKET_SSE
+	const __m128 tx0{ _mm_mul_ps(_mm_set1_ps(min[0] - from[0]), _mm_load_ps(ix)) };
+	const __m128 tx1{ _mm_mul_ps(_mm_set1_ps(max[0] - from[0]), _mm_load_ps(ix)) };
+	const __m128 ty0{ _mm_mul_ps(_mm_set1_ps(min[1] - from[1]), _mm_load_ps(iy)) };
+	const __m128 ty1{ _mm_mul_ps(_mm_set1_ps(max[1] - from[1]), _mm_load_ps(iy)) };
+	const __m128 tz0{ _mm_mul_ps(_mm_set1_ps(min[2] - from[2]), _mm_load_ps(iz)) };
+	const __m128 tz1{ _mm_mul_ps(_mm_set1_ps(max[2] - from[2]), _mm_load_ps(iz)) };
+	const __m128 lower_t{ _mm_max_ps(_mm_max_ps(
+		_mm_min_ps(tx0, tx1), _mm_min_ps(ty0, ty1)), _mm_min_ps(tz0, tz1)) };
+	const __m128 upper_t{ _mm_min_ps(_mm_min_ps(
+		_mm_max_ps(tx0, tx1), _mm_max_ps(ty0, ty1)), _mm_max_ps(tz0, tz1)) };
+	const __m128 valid{ _mm_and_ps(_mm_and_ps(
+		_mm_cmple_ps(lower_t, upper_t),
+		_mm_cmpge_ps(upper_t, _mm_setzero_ps())),
+		_mm_cmple_ps(lower_t, _mm_load_ps(t))) };
+	_mm_store_ps(lower, lower_t);
+	result = _mm_movemask_ps(valid) & mask;
+#else
+	for (int lane{ 0 }; lane < size; lane++) {
+		if ((mask & (1 << lane)) == 0) continue;
+		const glm::vec3 inverse{ ix[lane], iy[lane], iz[lane] };
+		const glm::vec3 t0{ (min - from) * inverse };
+		const glm::vec3 t1{ (max - from) * inverse };
+		const glm::vec3 l{ glm::min(t0, t1) };
+		const glm::vec3 u{ glm::max(t0, t1) };
+		lower[lane] = std::max(std::max(l[0], l[1]), l[2]);
+		const float upper{ std::min(std::min(u[0], u[1]), u[2]) };
+		if (lower[lane] <= upper && upper >= 0 && lower[lane] <= t[lane]) {
+			result |= 1 << lane;
+		}
+	}
+#endif
+	t_near = std::numeric_limits<float>::infinity();
+	for (int lane{ 0 }; lane < size; lane++) {
+		if (result & (1 << lane)) t_near = std::min(t_near, lower[lane]);
+	}
+	return result;
+}
+
+void RayPacket::intersect(const std::vector<Triangle>& triangles,
+	size_t first, size_t count, int mask) {
+#ifdef PACKET_SSE
+	// The same Moller-Trumbore test as Triangle::intersect, with one ray
+	// per lane. The origin is shared so s, q and the t numerator are the
+	// same in every lane, they are still worked out with the same vector
+	// operations in the same order as TriangleBuffer::_test so the
+	// compiler cannot fuse them differently from the scalar path
+	const __m128 dx{ _mm_load_ps(x) };
+	const __m128 dy{ _mm_load_ps(y) };
+	const __m128 dz{ _mm_load_ps(z) };
+	const __m128 zero{ _mm_setzero_ps() };
+	const __m128 sign_bit{ _mm_set1_ps(-0.0f) };
+	const __m128 lanes{ _mm_castsi128_ps(_mm_setr_epi32(
+		(mask & 1) ? -1 : 0, (mask & 2) ? -1 : 0,
+		(mask & 4) ? -1 : 0, (mask & 8) ? -1 : 0)) };
+	__m128 best_t{ _mm_load_ps(t) };
+	__m128 best_u{ _mm_load_ps(u) };
+	__m128 best_v{ _mm_load_ps(v) };
+	for (size_t i{ first }; i < first + count; i++) {
+		const Triangle& current{ triangles[i] };
+		const __m128 e1x{ _mm_set1_ps(current.e1[0]) };
+		const __m128 e1y{ _mm_set1_ps(current.e1[1]) };
+		const __m128 e1z{ _mm_set1_ps(current.e1[2]) };
+		const __m128 e2x{ _mm_set1_ps(current.e2[0]) };
+		const __m128 e2y{ _mm_set1_ps(current.e2[1]) };
+		const __m128 e2z{ _mm_set1_ps(current.e2[2]) };
+
+		const __m128 px{ _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y)) };
+		const __m128 py{ _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z)) };
+		const __m128 pz{ _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x)) };
+		__m128 det{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px),
+			_mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz)) };
+		const __m128 sign{ _mm_and_ps(det, sign_bit) };
+		det = _mm_xor_ps(det, sign);
+
+		const __m128 sx{ _mm_sub_ps(_mm_set1_ps(from[0]), _mm_set1_ps(current.a[0])) };
+		const __m128 sy{ _mm_sub_ps(_mm_set1_ps(from[1]), _mm_set1_ps(current.a[1])) };
+		const __m128 sz{ _mm_sub_ps(_mm_set1_ps(from[2]), _mm_set1_ps(current.a[2])) };
+		const __m128 lane_u{ _mm_xor_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px),
+			_mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), sign) };
+		const __m128 qx{ _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y)) };
+		const __m128 qy{ _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z)) };
+		const __m128 qz{ _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x)) };
+		const __m128 lane_v{ _mm_xor_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx),
+			_mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), sign) };
+		const __m128 lane_t{ _mm_xor_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx),
+			_mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), sign) };
+
+		__m128 valid{ _mm_and_ps(lanes, _mm_cmpneq_ps(det, zero)) };
+		valid = _mm_and_ps(valid, _mm_cmpge_ps(lane_u, zero));
+		valid = _mm_and_ps(valid, _mm_cmple_ps(lane_u, det));
+		valid = _mm_and_ps(valid, _mm_cmpge_ps(lane_v, zero));
+		valid = _mm_and_ps(valid, _mm_cmplt_ps(_mm_add_ps(lane_u, lane_v), det));
+		valid = _mm_and_ps(valid, _mm_cmpgt_ps(lane_t, zero));
+		valid = _mm_and_ps(valid, _mm_cmplt_ps(lane_t, _mm_mul_ps(best_t, det)));
+		const int found{ _mm_movemask_ps(valid) };
+		if (found == 0) continue;
+
+		const __m128 inverse{ _mm_div_ps(_mm_set1_ps(1.0f), det) };
+		best_t = _mm_or_ps(_mm_and_ps(valid, _mm_mul_ps(lane_t, inverse)),
+			_mm_andnot_ps(valid, best_t));
+		best_u = _mm_or_ps(_mm_and_ps(valid, _mm_mul_ps(lane_u, inverse)),
+			_mm_andnot_ps(valid, best_u));
+		best_v = _mm_or_ps(_mm_and_ps(valid, _mm_mul_ps(lane_v, inverse)),
+			_mm_andnot_ps(valid, best_v));
+		for (int lane{ 0 }; lane < size; lane++) {
+			if (found & (1 << lane)) triangle[lane] = i;
+		}
+		hits |= found;
+	}
+	_mm_store_ps(t, best_t);
+	_mm_store_ps(u, best_u);
+	_mm_store_ps(v, best_v);
+#else
+	for (size_t i{ first }; i < first + count; i++) {
+		for (int lane{ 0 }; lane < size; lane++) {
+			if ((mask & (1 << lane)) == 0) continue;
+			Hit hit;
+			if (!triangles[i].intersect(from, this->ray(lane), 0, t[lane], hit)) continue;
+			t[lane] = hit.t;
+			u[lane] = hit.u;
+			v[lane] = hit.v;
+			triangle[lane] = i;
+			hits |= 1 << lane;
+		}
+	}
+#endif
+}
+void RayPacket::intersect(const std::vector<Triangle>& triangles) {
+	this->intersect(triangles, 0, triangles.size(), active);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "triangle.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PACKET_SSE
+#endif
+
+// Four rays from one origin stored lane by lane, so box and triangle
+// tests run on every ray of the packet with a single SSE instruction
+struct RayPacket {
+	static const int size{ 4 };
+
+	glm::vec3 from{ };
+	alignas(16) float x[size]{ }, y[size]{ }, z[size]{ };
+	alignas(16) float ix[size]{ }, iy[size]{ }, iz[size]{ };
+	alignas(16) float t[size]{ }, u[size]{ }, v[size]{ };
+	size_t triangle[size]{ };
+	int active{ 0 }, hits{ 0 };
+
+	RayPacket(const glm::vec3& from);
+
+	void add(int lane, const glm::vec3& ray);
+	glm::vec3 ray(int lane) const;
+	Hit hit(int lane) const;
+	bool coherent() const;
+
+	int hitBox(const glm::vec3& min,
+		const glm::vec3& max,
+		int mask, float& t_near) const;
+	void intersect(const std::vector<Triangle>& triangles,
+		size_t first, size_t count, int mask);
+	void intersect(const std::vector<Triangle>& triangles);
+};
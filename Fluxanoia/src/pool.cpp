@@ -0,0 +1,90 @@
+#include "pool.hpp"
+
+ThreadPool::ThreadPool(size_t threads) {
+	if (threads <= 1) return;
+	for (size_t id{ 0 }; id < threads; id++) {
+		queues.push_back(std::unique_ptr<Queue>{ new Queue{ } });
+	}
+	for (size_t id{ 0 }; id < threads; id++) {
+		workers.push_back(std::thread{ &ThreadPool::_work, this, id });
+	}
+}
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers) worker.join();
+}
+
+size_t ThreadPool::size() const {
+	return workers.empty() ? 1 : workers.size();
+}
+
+void ThreadPool::run(size_t tasks, const std::function<void(size_t)>& work) {
+	if (workers.empty()) {
+		for (size_t task{ 0 }; task < tasks; task++) work(task);
+		return;
+	}
+	if (tasks == 0) return;
+
+	// Tasks are dealt out in contiguous runs so neighbouring tiles
+	// start on the same worker, stealing evens out the rest
+	this->work = &work;
+	remaining = tasks;
+	for (size_t id{ 0 }; id < queues.size(); id++) {
+		std::lock_guard<std::mutex> lock{ queues.at(id)->mutex };
+		const size_t first{ tasks * id / queues.size() };
+		const size_t last{ tasks * (id + 1) / queues.size() };
+		for (size_t task{ first }; task < last; task++) {
+			queues.at(id)->tasks.push_back(task);
+		}
+	}
+
+	std::unique_lock<std::mutex> lock{ mutex };
+	generation++;
+	wake.notify_all();
+	done.wait(lock, [&]() { return remaining == 0; });
+}
+
+void ThreadPool::_work(size_t id) {
+	size_t seen{ 0 };
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock{ mutex };
+			wake.wait(lock, [&]() { return stopping || generation != seen; });
+			if (stopping) return;
+			seen = generation;
+		}
+		size_t task;
+		while (this->_take(id, task)) {
+			(*work)(task);
+			if (--remaining == 0) {
+				std::lock_guard<std::mutex> lock{ mutex };
+				done.notify_all();
+			}
+		}
+	}
+}
+bool ThreadPool::_take(size_t id, size_t& task) {
+	{
+		Queue& own{ *queues.at(id) };
+		std::lock_guard<std::mutex> lock{ own.mutex };
+		if (!own.tasks.empty()) {
+			task = own.tasks.front();
+			own.tasks.pop_front();
+			return true;
+		}
+	}
+	for (size_t offset{ 1 }; offset < queues.size(); offset++) {
+		Queue& other{ *queues.at((id + offset) % queues.size()) };
+		std::lock_guard<std::mutex> lock{ other.mutex };
+		if (!other.tasks.empty()) {
+			task = other.tasks.back();
+			other.tasks.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
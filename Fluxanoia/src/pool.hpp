@@ -0,0 +1,45 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+class ThreadPool {
+private:
+
+	// Each worker drains its own queue from the front and, once that
+	// is empty, steals from the back of the other workers' queues
+	struct Queue {
+		std::mutex mutex{ };
+		std::deque<size_t> tasks{ };
+	};
+
+	std::vector<std::thread> workers{ };
+	std::vector<std::unique_ptr<Queue>> queues{ };
+
+	std::mutex mutex{ };
+	std::condition_variable wake{ };
+	std::condition_variable done{ };
+	size_t generation{ 0 };
+	bool stopping{ false };
+
+	std::atomic<size_t> remaining{ 0 };
+	const std::function<void(size_t)>* work{ nullptr };
+
+	void _work(size_t id);
+	bool _take(size_t id, size_t& task);
+
+public:
+
+	ThreadPool(size_t threads);
+	~ThreadPool();
+
+	size_t size() const;
+	void run(size_t tasks, const std::function<void(size_t)>& work);
+
+};
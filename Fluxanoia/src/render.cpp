@@ -1,7 +1,15 @@
 #include "render.hpp"
 
+#include <cmath>
+#include <limits>
+#include <stdexcept>
 #include <algorithm>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RENDER_SSE
+#include <emmintrin.h>
+#endif
+
 bool Render::in(DrawingWindow& window, glm::vec2 coord) {
 	if (!Maths::in(coord[0], 0,
 		static_cast<float>(window.width))) return false;
@@ -25,116 +33,235 @@ bool Render::in(DrawingWindow& window, CanvasTriangle tri) {
 		|| Render::in(window, tri.v2());
 }
 
-uint32_t Render::_getTextureColour(TextureMap& map,
+bool Render::in(const Target& target, glm::vec2 coord) {
+	if (!Maths::in(coord[0], 0,
+		static_cast<float>(target.width))) return false;
+	if (!Maths::in(coord[1], 0,
+		static_cast<float>(target.height))) return false;
+	return true;
+}
+bool Render::in(const Target& target, CanvasPoint p1, CanvasPoint p2) {
+	return Render::in(target, glm::vec2{ p1.x, p1.y })
+		|| Render::in(target, glm::vec2{ p2.x, p2.y });
+}
+bool Render::in(const Target& target, CanvasTriangle tri) {
+	return Render::in(target, glm::vec2{ tri.v0().x, tri.v0().y })
+		|| Render::in(target, glm::vec2{ tri.v1().x, tri.v1().y })
+		|| Render::in(target, glm::vec2{ tri.v2().x, tri.v2().y });
+}
+
+uint32_t Render::_getTextureColour(const Sampler& map,
 	float x, float y) {
 	int tx{ static_cast<int>(x) };
 	int ty{ static_cast<int>(y) };
-	return map.pixels.at(tx + ty * map.width);
+	const size_t index{ tx + ty * map.width };
+	if (index >= map.width * map.height) {
+		throw std::out_of_range("Texture coordinate out of range.");
+	}
+	if (map.layout == TextureLayout::LINEAR) return map.pixels[index];
+
+	// Coordinates past either side wrap onto the neighbouring row, as
+	// they do when the texture is row-major
+	if (static_cast<size_t>(tx) < map.width) {
+		return map.pixels[map.index(tx, ty)];
+	}
+	return map.pixels[map.index(index % map.width, index / map.width)];
+}
+uint32_t Render::_getBilinearColour(const Sampler& map,
+	float x, float y) {
+	// Texel centres sit half a texel in, the four texels around the
+	// sample are clamped to the edges and weighted in 1/256ths
+	const int last_x{ static_cast<int>(map.width) - 1 };
+	const int last_y{ static_cast<int>(map.height) - 1 };
+	const int sx{ static_cast<int>(std::min(std::max(x - 0.5f, 0.0f),
+		static_cast<float>(last_x)) * 256) };
+	const int sy{ static_cast<int>(std::min(std::max(y - 0.5f, 0.0f),
+		static_cast<float>(last_y)) * 256) };
+	const int x_0{ sx >> 8 }, x_1{ std::min(x_0 + 1, last_x) };
+	const int y_0{ sy >> 8 }, y_1{ std::min(y_0 + 1, last_y) };
+	const uint32_t fx{ static_cast<uint32_t>(sx & 255) };
+	const uint32_t fy{ static_cast<uint32_t>(sy & 255) };
+	const uint32_t t_00{ map.pixels[map.index(x_0, y_0)] };
+	const uint32_t t_10{ map.pixels[map.index(x_1, y_0)] };
+	const uint32_t t_01{ map.pixels[map.index(x_0, y_1)] };
+	const uint32_t t_11{ map.pixels[map.index(x_1, y_1)] };
+#ifdef RENDER_SSE
+	// Each row's pair of texels is widened to 16 bit channels, the rows
+	// are blended together and then the two halves of the result
+	const __m128i zero{ _mm_setzero_si128() };
+	const __m128i top{ _mm_unpacklo_epi8(_mm_unpacklo_epi32(
+		_mm_cvtsi32_si128(static_cast<int>(t_00)),
+		_mm_cvtsi32_si128(static_cast<int>(t_10))), zero) };
+	const __m128i bottom{ _mm_unpacklo_epi8(_mm_unpacklo_epi32(
+		_mm_cvtsi32_si128(static_cast<int>(t_01)),
+		_mm_cvtsi32_si128(static_cast<int>(t_11))), zero) };
+	const __m128i rows{ _mm_srli_epi16(_mm_add_epi16(
+		_mm_mullo_epi16(top, _mm_set1_epi16(static_cast<short>(256 - fy))),
+		_mm_mullo_epi16(bottom, _mm_set1_epi16(static_cast<short>(fy)))), 8) };
+	const __m128i columns{ _mm_mullo_epi16(rows, _mm_set_epi16(
+		fx, fx, fx, fx, 256 - fx, 256 - fx, 256 - fx, 256 - fx)) };
+	const __m128i blend{ _mm_srli_epi16(_mm_add_epi16(
+		columns, _mm_srli_si128(columns, 8)), 8) };
+	return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(blend, zero)));
+#else
+	uint32_t texel{ 0 };
+	for (uint32_t shift{ 0 }; shift < 32; shift += 8) {
+		const uint32_t left{ (((t_00 >> shift) & 0xFF) * (256 - fy)
+			+ ((t_01 >> shift) & 0xFF) * fy) >> 8 };
+		const uint32_t right{ (((t_10 >> shift) & 0xFF) * (256 - fy)
+			+ ((t_11 >> shift) & 0xFF) * fy) >> 8 };
+		texel |= ((left * (256 - fx) + right * fx) >> 8) << shift;
+	}
+	return texel;
+#endif
+}
+uint32_t Render::sampleTexture(const Sampler& map,
+	float x, float y) {
+	return map.filter == TextureFilter::BILINEAR
+		? Render::_getBilinearColour(map, x, y)
+		: Render::_getTextureColour(map, x, y);
 }
 
-std::vector<glm::vec3> Render::_coordifyLine(
-	CanvasPoint& p1, CanvasPoint& p2) {
-	size_t steps{ static_cast<size_t>(
-		std::max(abs(p2.x - p1.x), abs(p2.y - p1.y))) };
-	return Maths::interpolate3D(
-		{ p1.x, p1.y, p1.depth }, { p2.x, p2.y, p2.depth }, steps + 2);
-}
-std::vector<glm::vec2> Render::_coordifyLine(size_t steps,
-	TexturePoint& p1, TexturePoint& p2) {
-	return Maths::interpolate2D(
-		{ p1.x, p1.y }, { p2.x, p2.y }, steps + 2);
-}
-
-std::vector<glm::vec2> Render::_coordifyTriangleTop(
-	CanvasPoint top,
-	CanvasPoint middle_1,
-	CanvasPoint middle_2) {
-	return Maths::interpolate2D({ top.x, top.x },
-		{ middle_1.x, middle_2.x }, 
-		static_cast<size_t>(middle_1.y) 
-		- static_cast<size_t>(top.y) + 1);
-}
-std::vector<glm::vec2> Render::_coordifyTriangleBottom(
-	CanvasPoint middle_1,
-	CanvasPoint middle_2,
-	CanvasPoint bottom) {
-	return Maths::interpolate2D({ middle_1.x, middle_2.x },
-		{ bottom.x, bottom.x }, 
-		static_cast<size_t>(bottom.y) 
-		- static_cast<size_t>(middle_1.y) + 1);
-}
-std::vector<glm::vec2> Render::_coordifyTriangleTop(
-	size_t steps,
-	TexturePoint top,
-	TexturePoint middle_1,
-	TexturePoint middle_2) {
-	return Maths::interpolate2D({ top.x, top.x },
-		{ middle_1.x, middle_2.x }, steps);
-}
-std::vector<glm::vec2> Render::_coordifyTriangleBottom(
-	size_t steps,
-	TexturePoint middle_1,
-	TexturePoint middle_2,
-	TexturePoint bottom) {
-	return Maths::interpolate2D({ middle_1.x, middle_2.x },
-		{ bottom.x, bottom.x }, steps);
+size_t Render::_lineSteps(const CanvasPoint& p1, const CanvasPoint& p2) {
+	return static_cast<size_t>(
+		std::max(abs(p2.x - p1.x), abs(p2.y - p1.y)));
 }
 
 void Render::drawLine(DrawingWindow& window,
 	CanvasPoint p1, CanvasPoint p2, 
 	Colour c, float alpha,
 	std::vector<float>* depth) {
-	if (!Render::in(window, p1, p2)) return;
-
-	for (auto coord : _coordifyLine(p1, p2)) {
-		if (!Render::in(window, coord)) continue;
-		const size_t x{ static_cast<size_t>(coord[0]) };
-		const size_t y{ static_cast<size_t>(coord[1]) };
-		const size_t index{ x + window.width * y };
-		if (depth != nullptr) {
-			if (depth->at(index) > coord[2]) continue;
-			depth->at(index) = coord[2];
+	Target target{ window, depth };
+	Render::drawLine(target, p1, p2, Maths::pack(c, alpha));
+}
+bool Render::_clipLine(const Target& target,
+	CanvasPoint& p1, CanvasPoint& p2) {
+	if (!std::isfinite(p1.x + p1.y + p2.x + p2.y)) return false;
+
+	// Liang-Barsky, each edge of the rectangle moves one end of the
+	// line inwards and the line is gone once the ends cross
+	const float dx{ p2.x - p1.x }, dy{ p2.y - p1.y };
+	const float p[4]{ -dx, dx, -dy, dy };
+	const float q[4]{
+		p1.x - target.x_min, target.x_max - p1.x,
+		p1.y - target.y_min, target.y_max - p1.y };
+	float t_in{ 0 }, t_out{ 1 };
+	for (size_t i{ 0 }; i < 4; i++) {
+		if (p[i] == 0) {
+			if (q[i] < 0) return false;
+			continue;
+		}
+		const float t{ q[i] / p[i] };
+		if (p[i] < 0) t_in = std::max(t_in, t);
+		else t_out = std::min(t_out, t);
+	}
+	if (t_in > t_out) return false;
+
+	const CanvasPoint start{ p1 };
+	const float dz{ p2.depth - start.depth };
+	p1 = { start.x + t_in * dx, start.y + t_in * dy, start.depth + t_in * dz };
+	p2 = { start.x + t_out * dx, start.y + t_out * dy, start.depth + t_out * dz };
+	return true;
+}
+void Render::drawLine(Target& target,
+	CanvasPoint p1, CanvasPoint p2,
+	uint32_t colour) {
+	if (!Render::_clipLine(target, p1, p2)) return;
+
+	// The clipped ends can land on the far edges of the rectangle, they
+	// are pulled back onto its last pixels
+	const int x_first{ static_cast<int>(target.x_min) };
+	const int y_first{ static_cast<int>(target.y_min) };
+	const int x_last{ static_cast<int>(target.x_max) - 1 };
+	const int y_last{ static_cast<int>(target.y_max) - 1 };
+	const int x_1{ std::min(std::max(static_cast<int>(p1.x), x_first), x_last) };
+	const int y_1{ std::min(std::max(static_cast<int>(p1.y), y_first), y_last) };
+	const int x_2{ std::min(std::max(static_cast<int>(p2.x), x_first), x_last) };
+	const int y_2{ std::min(std::max(static_cast<int>(p2.y), y_first), y_last) };
+
+	// Bresenham, every step moves one pixel along the longer axis so
+	// the depth moves by the same amount each step
+	const int dx{ std::abs(x_2 - x_1) }, dy{ -std::abs(y_2 - y_1) };
+	const int sx{ x_1 < x_2 ? 1 : -1 }, sy{ y_1 < y_2 ? 1 : -1 };
+	const int steps{ std::max(dx, -dy) };
+	const float dz{ steps == 0 ? 0 : (p2.depth - p1.depth) / steps };
+	int error{ dx + dy };
+	float z{ p1.depth };
+	for (int x{ x_1 }, y{ y_1 };; z += dz) {
+		if (target.test(x, y, z)) target.setPixel(x, y, colour);
+		if (x == x_2 && y == y_2) break;
+		const int twice{ 2 * error };
+		if (twice >= dy) {
+			error += dy;
+			x += sx;
+		}
+		if (twice <= dx) {
+			error += dx;
+			y += sy;
 		}
-		window.setPixelColour(x, y, Maths::pack(c, alpha));
+	}
+}
+void Render::_drawSpan(Target& target,
+	CanvasPoint p1, CanvasPoint p2,
+	uint32_t colour) {
+	// Both ends of a span can be off the window while it crosses it
+	if (!(std::max(p1.x, p2.x) >= 0 && std::min(p1.x, p2.x) < target.width)) return;
+
+	const size_t count{ Render::_lineSteps(p1, p2) + 2 };
+	Maths::Interpolator x{ p1.x, p2.x, count };
+	Maths::Interpolator y{ p1.y, p2.y, count };
+	Maths::Interpolator z{ p1.depth, p2.depth, count };
+	for (size_t index{ 0 }; index < count; index++, x.next(), y.next(), z.next()) {
+		const glm::vec3 coord{ x.value(), y.value(), z.value() };
+		if (!Render::in(target, glm::vec2{ coord[0], coord[1] })) continue;
+		const size_t px{ static_cast<size_t>(coord[0]) };
+		const size_t py{ static_cast<size_t>(coord[1]) };
+		if (!target.test(px, py, coord[2])) continue;
+		target.setPixel(px, py, colour);
 	}
 }
 
 void Render::mapLine(DrawingWindow& window,
 	CanvasPoint p1, CanvasPoint p2,
-	TextureMap map, std::vector<float>* depth) {
-	auto coords{ _coordifyLine(p1, p2) };
-	auto texture_coords{ _coordifyLine(coords.size(), 
-		p1.texturePoint, p2.texturePoint) };
-	for (size_t index{ 0 }; index < coords.size(); index++) {
-		auto coord{ coords.at(index) };
-		auto texture_coord{ texture_coords.at(index) };
-
-		if (!Render::in(window, coord)) continue;
-		
-		const size_t x{ static_cast<size_t>(coord[0]) };
-		const size_t y{ static_cast<size_t>(coord[1]) };
-		const size_t depth_index{ x + window.width * y };
-		if (depth != nullptr) {
-			if (depth->at(depth_index) > coord[2]) continue;
-			depth->at(depth_index) = coord[2];
-		}
+	const Sampler& map, std::vector<float>* depth) {
+	Target target{ window, depth };
+	Render::mapLine(target, p1, p2, map);
+}
+void Render::mapLine(Target& target,
+	CanvasPoint p1, CanvasPoint p2,
+	const Sampler& map) {
+	// The texture coordinates are spread over two more values than
+	// the line has pixels, so the last texel is never quite reached
+	const size_t count{ Render::_lineSteps(p1, p2) + 2 };
+	Maths::Interpolator x{ p1.x, p2.x, count };
+	Maths::Interpolator y{ p1.y, p2.y, count };
+	Maths::Interpolator z{ p1.depth, p2.depth, count };
+	Maths::Interpolator u{ p1.texturePoint.x, p2.texturePoint.x, count + 2 };
+	Maths::Interpolator v{ p1.texturePoint.y, p2.texturePoint.y, count + 2 };
+	for (size_t index{ 0 }; index < count;
+		index++, x.next(), y.next(), z.next(), u.next(), v.next()) {
+		const glm::vec3 coord{ x.value(), y.value(), z.value() };
+		if (!Render::in(target, glm::vec2{ coord[0], coord[1] })) continue;
 
-		window.setPixelColour(x, y,
-			Render::_getTextureColour(map, 
-				texture_coord[0], texture_coord[1]));
+		const size_t px{ static_cast<size_t>(coord[0]) };
+		const size_t py{ static_cast<size_t>(coord[1]) };
+		if (!target.test(px, py, coord[2])) continue;
+
+		target.setPixel(px, py,
+			Render::sampleTexture(map, u.value(), v.value()));
 	}
 }
 
 void Render::drawTriangle(DrawingWindow& window,
 	CanvasTriangle triangle, Colour c, float alpha) {
-	if (!Render::in(window, triangle)) return;
-
-	Render::drawLine(window,
-		triangle.v0(), triangle.v1(), c, alpha);
-	Render::drawLine(window,
-		triangle.v1(), triangle.v2(), c, alpha);
-	Render::drawLine(window,
-		triangle.v2(), triangle.v0(), c, alpha);
+	Target target{ window };
+	Render::drawTriangle(target, triangle, Maths::pack(c, alpha));
+}
+void Render::drawTriangle(Target& target,
+	CanvasTriangle triangle, uint32_t colour) {
+	Render::drawLine(target, triangle.v0(), triangle.v1(), colour);
+	Render::drawLine(target, triangle.v1(), triangle.v2(), colour);
+	Render::drawLine(target, triangle.v2(), triangle.v0(), colour);
 }
 
 void Render::_pointifyTriangle(CanvasTriangle& t,
@@ -142,15 +269,21 @@ void Render::_pointifyTriangle(CanvasTriangle& t,
 	CanvasPoint& middle_1,
 	CanvasPoint& middle_2,
 	CanvasPoint& bottom) {
-	std::vector<CanvasPoint> points{ t.v0(), t.v1(), t.v2() };
-	std::sort(points.begin(), points.end(),
-		[](CanvasPoint p1, CanvasPoint p2) {
-			return p1.y < p2.y;
+	// Insertion sort by y, the same stable order std::sort gives
+	// three points, without allocating
+	CanvasPoint points[3]{ t.v0(), t.v1(), t.v2() };
+	for (size_t i{ 1 }; i < 3; i++) {
+		const CanvasPoint point{ points[i] };
+		size_t j{ i };
+		while (j > 0 && point.y < points[j - 1].y) {
+			points[j] = points[j - 1];
+			j--;
 		}
-	);
-	top = points.front();
-	middle_1 = points.at(1);
-	bottom = points.back();
+		points[j] = point;
+	}
+	top = points[0];
+	middle_1 = points[1];
+	bottom = points[2];
 
 	float ratio{ ((middle_1.y - top.y) / (bottom.y - top.y)) };
 	middle_2 = {
@@ -164,111 +297,218 @@ void Render::_pointifyTriangle(CanvasTriangle& t,
 	};
 }
 
+bool Render::_span(float a, float b, float c, size_t size,
+	size_t& first, size_t& last) {
+	first = 0;
+	last = size - 1;
+
+	// Whatever the rasterisers make of a vertex that is not finite,
+	// it cannot be bounded, so the whole range is kept
+	if (!std::isfinite(a) || !std::isfinite(b) || !std::isfinite(c)) return true;
+
+	// The scanline path steps up to a pixel past the bottom of the
+	// triangle, the padding keeps the bounds conservative
+	const float low{ std::min({ a, b, c }) - 2 };
+	const float high{ std::max({ a, b, c }) + 2 };
+	if (high < 0 || low >= size) return false;
+	if (low > 0) first = static_cast<size_t>(low);
+	if (high < size) last = static_cast<size_t>(high);
+	return true;
+}
+float Render::_nearest(const CanvasTriangle& t) {
+	const float a{ t[0].depth }, b{ t[1].depth }, c{ t[2].depth };
+	if (!std::isfinite(a) || !std::isfinite(b) || !std::isfinite(c)) {
+		return std::numeric_limits<float>::infinity();
+	}
+
+	// Interpolated depths can drift past the vertices by rounding, the
+	// margin keeps tests against the nearest depth conservative
+	return std::max({ a, b, c }) + 1e-3f
+		* std::max({ std::abs(a), std::abs(b), std::abs(c) });
+}
+bool Render::_visible(Target& target,
+	const CanvasTriangle& t,
+	size_t& x_min, size_t& y_min,
+	size_t& x_max, size_t& y_max) {
+	if (!Render::_span(t[0].x, t[1].x, t[2].x, target.width, x_min, x_max)) return false;
+	if (!Render::_span(t[0].y, t[1].y, t[2].y, target.height, y_min, y_max)) return false;
+	x_min = std::max(x_min, target.x_min);
+	y_min = std::max(y_min, target.y_min);
+	x_max = std::min(x_max + 1, target.x_max);
+	y_max = std::min(y_max + 1, target.y_max);
+	if (x_min >= x_max || y_min >= y_max) return false;
+
+	if (target.hiz == nullptr || !target.hiz->hidden(
+		x_min, y_min, x_max, y_max, Render::_nearest(t))) return true;
+	target.culled_triangles++;
+	target.culled_pixels += (x_max - x_min) * (y_max - y_min);
+	return false;
+}
+
+size_t Render::_rows(float top, float bottom) {
+	// Rows are counted between the pixel rows of the ends, which may
+	// be above the window once triangles reach into the guard band
+	return static_cast<size_t>(std::floor(bottom) - std::floor(top)) + 1;
+}
+void Render::_fillHalf(Target& target,
+	float y, size_t rows,
+	glm::vec2 x_start, glm::vec2 x_end,
+	glm::vec2 depth_start, glm::vec2 depth_end,
+	uint32_t colour) {
+	Maths::Interpolator x_1{ x_start[0], x_end[0], rows };
+	Maths::Interpolator x_2{ x_start[1], x_end[1], rows };
+	Maths::Interpolator depth_1{ depth_start[0], depth_end[0], rows };
+	Maths::Interpolator depth_2{ depth_start[1], depth_end[1], rows };
+	for (size_t index{ 0 }; index < rows; index++,
+		x_1.next(), x_2.next(), depth_1.next(), depth_2.next()) {
+		const float row{ y + index };
+		if (row >= target.y_max) break;
+		if (row < target.y_min) continue;
+		Render::_drawSpan(target,
+			{ x_1.value(), row, depth_1.value() },
+			{ x_2.value(), row, depth_2.value() },
+			colour);
+	}
+}
+
 void Render::fillTriangle(DrawingWindow& window,
 	CanvasTriangle t, Colour c, float alpha,
-	std::vector<float>* depth) {
-	
-	if (!Render::in(window, t)) return;
-
-	CanvasPoint top, middle_1, middle_2, bottom;
-	Render::_pointifyTriangle(t, top, middle_1, middle_2, bottom);
-
-	std::vector<glm::vec2> coords{ 
-		Render::_coordifyTriangleTop(top, middle_1, middle_2) };
-	std::vector<glm::vec2> depth_coords{
-		Maths::interpolate2D({ top.depth, top.depth },
-		{ middle_1.depth, middle_2.depth }, coords.size()) };
-	for (size_t index{ 0 }; index < coords.size(); index++) {
-		auto coord{ coords.at(index) };
-		auto depth_coord{ depth_coords.at(index) };
-		float y{ top.y + index };
-		Render::drawLine(window, 
-			{ coord[0], y, depth_coord[0] }, 
-			{ coord[1], y, depth_coord[1] },
-			c, alpha, depth);
+	std::vector<float>* depth,
+	Rasteriser rasteriser) {
+	Target target{ window, depth };
+	Render::fillTriangle(target, t, Maths::pack(c, alpha), rasteriser);
+}
+void Render::fillTriangle(Target& target,
+	CanvasTriangle t, uint32_t colour,
+	Rasteriser rasteriser) {
+	size_t x_min, y_min, x_max, y_max;
+	if (!Render::_visible(target, t, x_min, y_min, x_max, y_max)) return;
+
+	// Triangles outside the half-space guard band fall back to the
+	// scanline path
+	HalfSpace half_space;
+	if (rasteriser == Rasteriser::HALFSPACE
+		&& Render::_setupHalfSpace(target, t, half_space)) {
+		Render::_drawHalfSpace(target, half_space, colour, nullptr);
+	} else {
+		CanvasPoint top, middle_1, middle_2, bottom;
+		Render::_pointifyTriangle(t, top, middle_1, middle_2, bottom);
+
+		Render::_fillHalf(target, top.y,
+			Render::_rows(top.y, middle_1.y),
+			{ top.x, top.x }, { middle_1.x, middle_2.x },
+			{ top.depth, top.depth }, { middle_1.depth, middle_2.depth },
+			colour);
+		Render::_fillHalf(target, middle_1.y,
+			Render::_rows(middle_1.y, bottom.y),
+			{ middle_1.x, middle_2.x }, { bottom.x, bottom.x },
+			{ middle_1.depth, middle_2.depth }, { bottom.depth, bottom.depth },
+			colour);
 	}
+	if (target.hiz != nullptr) target.hiz->touch(x_min, y_min, x_max, y_max);
+}
 
-	coords = Render::_coordifyTriangleBottom(middle_1, middle_2, bottom);
-	depth_coords = Maths::interpolate2D(
-		{ middle_1.depth, middle_2.depth },
-		{ bottom.depth, bottom.depth }, coords.size());
-	for (size_t index{ 0 }; index < coords.size(); index++) {
-		auto coord{ coords.at(index) };
-		auto depth_coord{ depth_coords.at(index) };
-		float y{ middle_1.y + index };
-		Render::drawLine(window,
-			{ coord[0], y, depth_coord[0] },
-			{ coord[1], y, depth_coord[1] },
-			c, alpha, depth);
+void Render::_mapHalf(Target& target,
+	float y, size_t rows,
+	const CanvasPoint& start_1, const CanvasPoint& start_2,
+	const CanvasPoint& end_1, const CanvasPoint& end_2,
+	const Sampler& map) {
+	// Texture y steps by multiplying rather than accumulating, as
+	// the original per-row vectors did
+	Maths::Interpolator x_1{ start_1.x, end_1.x, rows };
+	Maths::Interpolator x_2{ start_2.x, end_2.x, rows };
+	Maths::Interpolator u_1{ start_1.texturePoint.x, end_1.texturePoint.x, rows };
+	Maths::Interpolator u_2{ start_2.texturePoint.x, end_2.texturePoint.x, rows };
+	Maths::Interpolator depth_1{ start_1.depth, end_1.depth, rows };
+	Maths::Interpolator depth_2{ start_2.depth, end_2.depth, rows };
+	const float texture_step_1{ (end_1.texturePoint.y - start_1.texturePoint.y) / rows };
+	const float texture_step_2{ (end_2.texturePoint.y - start_2.texturePoint.y) / rows };
+	for (size_t index{ 0 }; index < rows; index++, x_1.next(), x_2.next(),
+		u_1.next(), u_2.next(), depth_1.next(), depth_2.next()) {
+		const float row{ y + index };
+		if (row >= target.y_max) break;
+		if (row < target.y_min) continue;
+		CanvasPoint p1{ x_1.value(), row, depth_1.value() },
+			p2{ x_2.value(), row, depth_2.value() };
+		p1.texturePoint = { u_1.value(),
+			start_1.texturePoint.y + index * texture_step_1 };
+		p2.texturePoint = { u_2.value(),
+			start_2.texturePoint.y + index * texture_step_2 };
+		Render::mapLine(target, p1, p2, map);
 	}
 }
 
 void Render::mapTriangle(DrawingWindow& window,
-	CanvasTriangle t, TextureMap map,
-	std::vector<float>* depth) {
+	CanvasTriangle t, const Sampler& map,
+	std::vector<float>* depth,
+	Rasteriser rasteriser) {
+	Target target{ window, depth };
+	Render::mapTriangle(target, t, map, rasteriser);
+}
+const Render::Sampler& Render::_level(CanvasTriangle& t,
+	const Sampler& map) {
+	if (map.next == nullptr) return map;
+
+	// Texture coordinates are interpolated linearly across the screen,
+	// so their derivatives are the same over the whole triangle
+	const float area{ (t[1].x - t[0].x) * (t[2].y - t[0].y)
+		- (t[2].x - t[0].x) * (t[1].y - t[0].y) };
+	const glm::vec2 d_1{ t[1].texturePoint.x - t[0].texturePoint.x,
+		t[1].texturePoint.y - t[0].texturePoint.y };
+	const glm::vec2 d_2{ t[2].texturePoint.x - t[0].texturePoint.x,
+		t[2].texturePoint.y - t[0].texturePoint.y };
+	const glm::vec2 d_x{ (d_1 * (t[2].y - t[0].y) - d_2 * (t[1].y - t[0].y)) / area };
+	const glm::vec2 d_y{ (d_2 * (t[1].x - t[0].x) - d_1 * (t[2].x - t[0].x)) / area };
 
-	if (!Render::in(window, t)) return;
-
-	CanvasPoint top, middle_1, middle_2, bottom;
-	Render::_pointifyTriangle(t, top, middle_1, middle_2, bottom);
-
-	std::vector<glm::vec2> coords{
-		Render::_coordifyTriangleTop(top, middle_1, middle_2) };
-	std::vector<glm::vec2> texture_coords{
-		Render::_coordifyTriangleTop(coords.size(), top.texturePoint, 
-			middle_1.texturePoint, middle_2.texturePoint) };
-	std::vector<glm::vec2> depth_coords{
-		Maths::interpolate2D({ top.depth, top.depth },
-		{ middle_1.depth, middle_2.depth }, coords.size()) };
-	float texture_step_1{ (middle_1.texturePoint.y - top.texturePoint.y)
-		/ coords.size() };
-	float texture_step_2{ (middle_2.texturePoint.y - top.texturePoint.y)
-		/ coords.size() };
-	for (size_t index{ 0 }; index < coords.size(); index++) {
-		auto coord{ coords.at(index) };
-		auto texture_coord{ texture_coords.at(index) };
-		auto depth_coord{ depth_coords.at(index) };
-		float y{ top.y + index };
-		float texture_y_1{ top.texturePoint.y + index * texture_step_1 };
-		float texture_y_2{ top.texturePoint.y + index * texture_step_2 };
-		CanvasPoint p1{ coord[0], y, depth_coord[0] },
-			p2{ coord[1], y, depth_coord[1] };
-		p1.texturePoint = { texture_coord[0], texture_y_1 };
-		p2.texturePoint = { texture_coord[1], texture_y_2 };
-		Render::mapLine(window, p1, p2, map, depth);
+	// Each level halves the texels per pixel along both axes, the level
+	// nearest the larger of the two footprints is used
+	float footprint{ std::max(glm::dot(d_x, d_x), glm::dot(d_y, d_y)) };
+	const Sampler* level{ &map };
+	while (level->next != nullptr && footprint >= 2) {
+		level = level->next;
+		footprint /= 4;
 	}
+	if (level == &map) return map;
+
+	const float scale_x{ static_cast<float>(level->width) / map.width };
+	const float scale_y{ static_cast<float>(level->height) / map.height };
+	for (size_t i{ 0 }; i < 3; i++) {
+		t[i].texturePoint.x *= scale_x;
+		t[i].texturePoint.y *= scale_y;
+	}
+	return *level;
+}
+void Render::mapTriangle(Target& target,
+	CanvasTriangle t, const Sampler& base,
+	Rasteriser rasteriser) {
+	size_t x_min, y_min, x_max, y_max;
+	if (!Render::_visible(target, t, x_min, y_min, x_max, y_max)) return;
+	const Sampler& map{ Render::_level(t, base) };
+
+	HalfSpace half_space;
+	if (rasteriser == Rasteriser::HALFSPACE
+		&& Render::_setupHalfSpace(target, t, half_space)) {
+		Render::_drawHalfSpace(target, half_space, 0, &map);
+	} else {
+		CanvasPoint top, middle_1, middle_2, bottom;
+		Render::_pointifyTriangle(t, top, middle_1, middle_2, bottom);
 
-	coords = Render::_coordifyTriangleBottom(middle_1, middle_2, bottom);
-	texture_coords = Render::_coordifyTriangleBottom(coords.size(),
-		middle_1.texturePoint, middle_2.texturePoint, bottom.texturePoint);
-	texture_step_1 = (bottom.texturePoint.y - middle_1.texturePoint.y)
-		/ coords.size();
-	texture_step_2 = (bottom.texturePoint.y - middle_2.texturePoint.y)
-		/ coords.size();
-	depth_coords = Maths::interpolate2D(
-		{ middle_1.depth, middle_2.depth },
-		{ bottom.depth, bottom.depth }, coords.size());
-	for (size_t index{ 0 }; index < coords.size(); index++) {
-		auto coord{ coords.at(index) };
-		auto texture_coord{ texture_coords.at(index) };
-		auto depth_coord{ depth_coords.at(index) };
-		float y{ middle_1.y + index };
-		float texture_y_1{ middle_1.texturePoint.y + index * texture_step_1 };
-		float texture_y_2{ middle_2.texturePoint.y + index * texture_step_2 };
-		CanvasPoint p1{ coord[0], y, depth_coord[0] }, 
-			p2{ coord[1], y, depth_coord[1] };
-		p1.texturePoint = { texture_coord[0], texture_y_1 };
-		p2.texturePoint = { texture_coord[1], texture_y_2 };
-		Render::mapLine(window, p1, p2, map, depth);
+		Render::_mapHalf(target, top.y,
+			Render::_rows(top.y, middle_1.y),
+			top, top, middle_1, middle_2, map);
+		Render::_mapHalf(target, middle_1.y,
+			Render::_rows(middle_1.y, bottom.y),
+			middle_1, middle_2, bottom, bottom, map);
 	}
+	if (target.hiz != nullptr) target.hiz->touch(x_min, y_min, x_max, y_max);
 }
 
 void Render::renderMap(DrawingWindow& window, 
-	TextureMap map) {
-	for (size_t index{ 0 }; index < map.pixels.size(); index++) {
+	const Sampler& map) {
+	for (size_t index{ 0 }; index < map.width * map.height; index++) {
 		auto x{ index % map.width };
 		auto y{ (index - x) / map.width };
 		if (!Render::in(window, glm::vec2{ x,  y })) continue;
-		window.setPixelColour(x, y, map.pixels.at(index));
+		window.setPixelColour(x, y, map.pixels[map.index(x, y)]);
 	}
 }
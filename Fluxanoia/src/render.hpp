@@ -1,14 +1,18 @@
 #pragma once
 
 #include <Colour.h>
-#include <TextureMap.h>
 #include <CanvasPoint.h>
 #include <DrawingWindow.h>
 #include <CanvasTriangle.h>
 
 #include "maths.hpp"
+#include "target.hpp"
+#include "texture.hpp"
+#include "halfspace.hpp"
 
 enum class RenderMode { WIRE, RASTER, RAYTRACED };
+enum class Rasteriser { SCANLINE, HALFSPACE };
+enum class Shading { PHONG, GOURAUD };
 
 namespace Render {
 	
@@ -17,47 +21,46 @@ namespace Render {
 	bool in(DrawingWindow& window, CanvasPoint point);
 	bool in(DrawingWindow& window, CanvasPoint p1, CanvasPoint p2);
 	bool in(DrawingWindow& window, CanvasTriangle tri);
+	bool in(const Target& target, glm::vec2 coord);
+	bool in(const Target& target, CanvasPoint p1, CanvasPoint p2);
+	bool in(const Target& target, CanvasTriangle tri);
 
-	uint32_t _getTextureColour(TextureMap& map,
+	uint32_t _getTextureColour(const Sampler& map,
+		float x, float y);
+	uint32_t _getBilinearColour(const Sampler& map,
+		float x, float y);
+	uint32_t sampleTexture(const Sampler& map,
 		float x, float y);
 
-	std::vector<glm::vec3> _coordifyLine(
-		CanvasPoint& p1, CanvasPoint& p2);
-	std::vector<glm::vec2> _coordifyLine(size_t steps,
-		TexturePoint& p1, TexturePoint& p2);
-
-	std::vector<glm::vec2> _coordifyTriangleTop(
-		CanvasPoint top,
-		CanvasPoint middle_1,
-		CanvasPoint middle_2);
-	std::vector<glm::vec2> _coordifyTriangleBottom(
-		CanvasPoint middle_1,
-		CanvasPoint middle_2,
-		CanvasPoint bottom);
-	std::vector<glm::vec2> _coordifyTriangleTop(
-		size_t steps,
-		TexturePoint top,
-		TexturePoint middle_1,
-		TexturePoint middle_2);
-	std::vector<glm::vec2> _coordifyTriangleBottom(
-		size_t steps,
-		TexturePoint middle_1,
-		TexturePoint middle_2,
-		TexturePoint bottom);
+	size_t _lineSteps(const CanvasPoint& p1, const CanvasPoint& p2);
 
 	void drawLine(DrawingWindow& window,
 		CanvasPoint p1, CanvasPoint p2, 
 		Colour c, float alpha = 255,
 		std::vector<float>* depth = nullptr);
+	bool _clipLine(const Target& target,
+		CanvasPoint& p1, CanvasPoint& p2);
+	void drawLine(Target& target,
+		CanvasPoint p1, CanvasPoint p2,
+		uint32_t colour);
+	void _drawSpan(Target& target,
+		CanvasPoint p1, CanvasPoint p2,
+		uint32_t colour);
 
 	void mapLine(DrawingWindow& window,
 		CanvasPoint p1, CanvasPoint p2,
-		TextureMap map,
+		const Sampler& map,
 		std::vector<float>* depth = nullptr);
+	void mapLine(Target& target,
+		CanvasPoint p1, CanvasPoint p2,
+		const Sampler& map);
 
 	void drawTriangle(DrawingWindow& window,
 		CanvasTriangle triangle,
 		Colour c, float alpha = 255);
+	void drawTriangle(Target& target,
+		CanvasTriangle triangle,
+		uint32_t colour);
 
 	void _pointifyTriangle(
 		CanvasTriangle& triangle,
@@ -66,17 +69,48 @@ namespace Render {
 		CanvasPoint& middle_2,
 		CanvasPoint& bottom);
 
+	bool _span(float a, float b, float c, size_t size,
+		size_t& first, size_t& last);
+	float _nearest(const CanvasTriangle& triangle);
+	bool _visible(Target& target,
+		const CanvasTriangle& triangle,
+		size_t& x_min, size_t& y_min,
+		size_t& x_max, size_t& y_max);
+
+	size_t _rows(float top, float bottom);
+	void _fillHalf(Target& target,
+		float y, size_t rows,
+		glm::vec2 x_start, glm::vec2 x_end,
+		glm::vec2 depth_start, glm::vec2 depth_end,
+		uint32_t colour);
 	void fillTriangle(DrawingWindow& window,
 		CanvasTriangle triangle,
 		Colour c, float alpha = 255,
-		std::vector<float>* depth = nullptr);
+		std::vector<float>* depth = nullptr,
+		Rasteriser rasteriser = Rasteriser::SCANLINE);
+	void fillTriangle(Target& target,
+		CanvasTriangle triangle,
+		uint32_t colour,
+		Rasteriser rasteriser = Rasteriser::SCANLINE);
 
+	void _mapHalf(Target& target,
+		float y, size_t rows,
+		const CanvasPoint& start_1, const CanvasPoint& start_2,
+		const CanvasPoint& end_1, const CanvasPoint& end_2,
+		const Sampler& map);
+	const Sampler& _level(CanvasTriangle& triangle,
+		const Sampler& map);
 	void mapTriangle(DrawingWindow& window,
 		CanvasTriangle triangle,
-		TextureMap map, 
-		std::vector<float>* depth = nullptr);
+		const Sampler& map, 
+		std::vector<float>* depth = nullptr,
+		Rasteriser rasteriser = Rasteriser::SCANLINE);
+	void mapTriangle(Target& target,
+		CanvasTriangle triangle,
+		const Sampler& map,
+		Rasteriser rasteriser = Rasteriser::SCANLINE);
 
 	void renderMap(DrawingWindow& window, 
-		TextureMap map);
+		const Sampler& map);
 
 };
@@ -1,5 +1,9 @@
 #include "scene.hpp"
 
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+
 Scene::Scene() { }
 Scene::Scene(glm::vec3 camera_pos, float focal_length) {
 	this->camera_pos = camera_pos;
@@ -11,40 +15,50 @@ Scene::Scene(glm::vec3 camera_pos, float focal_length) {
 }
 
 void Scene::draw(DrawingWindow& window) {
-	switch (renderMode) {
-	case RenderMode::RASTER:
-		depth.assign(window.width * window.height, 0);
-		break;
-	case RenderMode::RAYTRACED:
-		this->_drawRaytraced(window);
-		return;
+	if (window.width != setup_width || window.height != setup_height) {
+		setup_width = window.width;
+		setup_height = window.height;
+		this->_invalidate();
 	}
 
-	std::vector<glm::vec3> points{ };
-	for (const std::pair<Object, float>& pair : objects) {
-		for (const Element& elem : pair.first.getElements()) {
-			this->_transformPoints(window, pair.second,
-				elem.points, points);
-
-			Material material{ "" };
-			for (auto mtl : materials) {
-				if (mtl.name.compare(elem.mtl) == 0) {
-					material = mtl;
-					break;
-				}
-			}
+	dirty = false;
+	if (shading == Shading::GOURAUD && (renderMode == RenderMode::RAYTRACED
+		|| (renderMode == RenderMode::RASTER && raster_lighting))) {
+		this->_lightVertices();
+	}
+	if (renderMode == RenderMode::RAYTRACED) {
+		if (!progressive) {
+			this->_drawRaytraced(window, 1, 0);
+			if (antialiasing) this->_antialias(window);
+		} else if (block > 0) {
+			this->_drawRaytraced(window, block,
+				block == preview_block ? 0 : block * 2);
+			block /= 2;
+		} else if (antialiasing && !antialiased) {
+			this->_antialias(window);
+			antialiased = true;
+		}
+		return;
+	}
 
-			switch (renderMode) {
-			case RenderMode::WIRE:
-				this->_drawWire(window, elem, points);
-				break;
-			case RenderMode::RASTER:
-				this->_drawRaster(window, elem, points, material);
-				break;
-			default:
-				throw std::exception("Unhandled draw mode.");
+	this->_transformElements(window);
+	switch (renderMode) {
+	case RenderMode::WIRE:
+		for (size_t o{ 0 }; o < objects.size(); o++) {
+			const std::vector<Element>& elements{ objects[o].first.getElements() };
+			for (size_t e{ 0 }; e < elements.size(); e++) {
+				this->_drawWire(window, elements[e], transformed[o][e].screen);
 			}
 		}
+		break;
+	case RenderMode::RASTER:
+		depth.reset(window.width, window.height);
+		if (raster_lighting) ids.assign(window.width * window.height, 0);
+		this->_setupRaster(window);
+		this->_drawTiles(window);
+		break;
+	default:
+		throw std::exception("Unhandled draw mode.");
 	}
 }
 
@@ -56,27 +70,45 @@ glm::mat4 Scene::_getExtrinsicMatrix() const {
 		glm::vec4{ -1.0f * extrinsic * camera_pos, 1.0f },
 	};
 }
-glm::vec3 Scene::_transformPoint(DrawingWindow& w, 
-	glm::vec3 p, float scale) {
-	p = calibration * glm::vec3{ this->_getExtrinsicMatrix() * glm::vec4{ p, 1.0f } };
-	return glm::vec3{
-		-scale * (p[0] / p[2]) + (w.width / 2),
-		-scale * (p[1] / p[2]) + (w.height / 2),
-		-1 / p[2]
-	};
-}
-void Scene::_transformPoints(DrawingWindow& w,
-	float scale,
-	std::vector<glm::vec3> p,
-	std::vector<glm::vec3>& out) {
-	out.clear();
-	for (glm::vec3 point : p) {
-		out.push_back(this->_transformPoint(w, point, scale));
+
+void Scene::_transformElements(DrawingWindow& window) {
+	if (transformed_version == view_version) return;
+
+	// The camera only moves between frames, so its matrices are joined
+	// once here rather than for every point
+	view = glm::mat4{ calibration } * this->_getExtrinsicMatrix();
+	transformed.resize(objects.size());
+	for (size_t o{ 0 }; o < objects.size(); o++) {
+		const std::vector<Element>& elements{ objects[o].first.getElements() };
+		const Render::Clipper clipper{ window.width, window.height, objects[o].second };
+		transformed[o].resize(elements.size());
+		for (size_t e{ 0 }; e < elements.size(); e++) {
+			clipper.transform(view, elements[e].points,
+				transformed[o][e].camera, transformed[o][e].screen);
+		}
 	}
+	transformed_version = view_version;
 }
+void Scene::_setupRaster(DrawingWindow& window) {
+	if (primitives_version == view_version) return;
 
+	primitives.clear();
+	for (size_t o{ 0 }; o < objects.size(); o++) {
+		const std::vector<Element>& elements{ objects[o].first.getElements() };
+		const Render::Clipper clipper{ window.width, window.height, objects[o].second };
+		for (size_t e{ 0 }; e < elements.size(); e++) {
+			const size_t index{ element_materials[o][e] };
+			const Material& material{ index < materials.size()
+				? materials[index] : missing_material };
+			this->_drawRaster(clipper, elements[e],
+				transformed[o][e].camera, transformed[o][e].screen,
+				face_ids[o][e], material);
+		}
+	}
+	primitives_version = view_version;
+}
 void Scene::_facePoints(const Face& face,
-	const std::vector<glm::vec3> points,
+	const std::vector<glm::vec3>& points,
 	CanvasPoint& a,
 	CanvasPoint& b,
 	CanvasPoint& c) {
@@ -88,8 +120,8 @@ void Scene::_facePoints(const Face& face,
 	c = { point_c[0], point_c[1], point_c[2] };
 }
 void Scene::_faceTexturePoints(const Face& face,
-	const std::vector<glm::vec2> texture_points,
-	const TextureMap& map,
+	const std::vector<glm::vec2>& texture_points,
+	const Render::Sampler& map,
 	CanvasPoint& a,
 	CanvasPoint& b,
 	CanvasPoint& c) {
@@ -104,158 +136,458 @@ void Scene::_faceTexturePoints(const Face& face,
 		map.height * point_tc[1] };
 }
 
-bool Scene::_raytrace(const glm::vec3& from,
-	const glm::vec3& ray,
-	const glm::vec3& a,
-	const glm::vec3& b,
-	const glm::vec3& c,
-	glm::vec3* sr,
-	glm::vec3* ur,
-	glm::vec3* vr) const {
-	glm::vec3 u{ b - a };
-	glm::vec3 v{ c - a };
-	auto mat{ glm::inverse(glm::mat3{ -ray, u, v }) };
-	auto vec{ glm::vec3{ from - a } };
-	glm::vec3 s{ mat * vec };
-	if (ur != nullptr) (*ur) = u;
-	if (vr != nullptr) (*vr) = v;
-	if (sr != nullptr) (*sr) = s;
-
-	if (isinf(s[0]) || isnan(s[0])) return false;
-	if (isinf(s[1]) || isnan(s[1])) return false;
-	if (isinf(s[2]) || isnan(s[2])) return false;
-	if (s[0] < 0) return false;
-	if (s[1] < 0 || s[1] > 1) return false;
-	if (s[2] < 0 || s[2] > 1) return false;
-	if (s[1] + s[2] >= 1) return false;
-	return true;
-}
-
 void Scene::_drawWire(DrawingWindow& window,
 	const Element& elem,
 	const std::vector<glm::vec3>& points) {
+	Render::Target target{ window };
+	const uint32_t colour{ Maths::pack(Colour{ 255, 255, 255 }) };
 	CanvasPoint a, b, c;
 	for (const Face& face : elem.faces) {
 		this->_facePoints(face, points, a, b, c);
-		Render::drawTriangle(window, { a, b, c },
-			{ 255, 255, 255 }, 255);
+		Render::drawTriangle(target, { a, b, c }, colour);
 	}
 }
-void Scene::_drawRaster(DrawingWindow& window,
+void Scene::_drawRaster(const Render::Clipper& clipper,
 	const Element& elem,
+	const std::vector<glm::vec3>& camera,
 	const std::vector<glm::vec3>& points,
+	const std::vector<uint32_t>& element_ids,
 	const Material& material) {
+	const uint32_t colour{ material.type == MaterialType::COLOUR
+		? Maths::pack(material.colour) : 0 };
+	const size_t texture{ material.type == MaterialType::TEXTURE
+		? material.texture : Render::TextureRegistry::none };
+	const Render::Sampler* map{ texture != Render::TextureRegistry::none
+		? &textures.sampler(texture) : nullptr };
 	CanvasPoint a, b, c;
-	for (const Face& face : elem.faces) {
+	CanvasTriangle fan[Render::Clipper::fan];
+	for (size_t f{ 0 }; f < elem.faces.size(); f++) {
+		const Face& face{ elem.faces[f] };
+		const uint32_t id{ element_ids[f] };
+		const uint8_t code_a{ clipper.outcode(camera.at(face.a)) };
+		const uint8_t code_b{ clipper.outcode(camera.at(face.b)) };
+		const uint8_t code_c{ clipper.outcode(camera.at(face.c)) };
+		if ((code_a & code_b & code_c) != 0) continue;
+
 		this->_facePoints(face, points, a, b, c);
-		switch (material.type) {
-		case MaterialType::COLOUR:
-			Render::fillTriangle(window, { a, b, c },
-				material.colour, 255, &depth);
-			break;
-		case MaterialType::TEXTURE:
-			for (auto pair : textures) {
-				if (pair.first.compare(material.texture) != 0) continue;
-				this->_faceTexturePoints(face,
-					elem.texture_points, pair.second, a, b, c);
-				Render::mapTriangle(window,
-					{ a, b, c }, pair.second, &depth);
-				break;
-			}
-			break;
+		if (map != nullptr) {
+			this->_faceTexturePoints(face,
+				elem.texture_points, *map, a, b, c);
+		}
+		if ((code_a | code_b | code_c) == 0) {
+			primitives.push_back({ { a, b, c }, colour, texture, id });
+			continue;
+		}
+
+		// Only triangles crossing the near plane or the guard band are
+		// cut, the pieces share the face's colour, texture and id
+		const Render::ClipVertex corners[3]{
+			{ camera[face.a], { a.texturePoint.x, a.texturePoint.y } },
+			{ camera[face.b], { b.texturePoint.x, b.texturePoint.y } },
+			{ camera[face.c], { c.texturePoint.x, c.texturePoint.y } } };
+		const size_t pieces{ clipper.clip(corners, fan) };
+		for (size_t i{ 0 }; i < pieces; i++) {
+			primitives.push_back({ fan[i], colour, texture, id });
 		}
 	}
 }
-void Scene::_drawRaytraced(DrawingWindow& window) {
-	const float field_of_view{ static_cast<float>(PI / 2) };
-	const float aspect_ratio{ static_cast<float>(window.height) 
-		/ static_cast<float>(window.width) };
-	const float half_view_width{ glm::tan(field_of_view / 2) };
-	const float half_view_height{ half_view_width * aspect_ratio };
-	const float half_screen_width{ static_cast<float>(window.width / 2) };
-	const float half_screen_height{ static_cast<float>(window.height / 2) };
-	const float delta_x{ half_view_width / half_screen_width };
-	const float delta_y{ half_view_height / half_screen_height };
-
-	for (float x = -half_screen_width; x < half_screen_width; x++) {
-		for (float y = -half_screen_height; y < half_screen_height; y++) {
-			bool collided{ false };
-			Face collided_face;
-			Element collided_elem;
-			float collided_scale{ 0 };
-			glm::vec3 global_solution{ }, output{ };
-			glm::vec3 ray{ extrinsic * glm::vec3{ delta_x * x, delta_y * y, -1 } };
-			ray[0] *= -1;
-			for (const std::pair<Object, float>& pair : objects) {
-				for (const Element& elem : pair.first.getElements()) {
-					const std::vector<glm::vec3>& points{ elem.points };
-					for (const Face& face : elem.faces) {
-						glm::vec3 s, u, v;
-						if (this->_raytrace(camera_pos, ray, 
-								points.at(face.a), points.at(face.b),
-								points.at(face.c), &s, &u, &v)
-							&& (!collided
-								|| (collided
-									&& s[0] < global_solution[0]))) {
-							collided = true;
-							global_solution = s;
-							output = points.at(face.a)
-								+ global_solution[1] * u
-								+ global_solution[2] * v;
-							collided_scale = pair.second;
-							collided_elem = elem;
-							collided_face = face;
-						}
-					}
-				}
+void Scene::_binPrimitive(DrawingWindow& window, size_t index) {
+	const CanvasTriangle& t{ primitives[index].triangle };
+	size_t first, last;
+	if (!Render::_span(t[0].x, t[1].x, t[2].x, window.width, first, last)) return;
+	if (!Render::_span(t[0].y, t[1].y, t[2].y, window.height, first, last)) return;
+	for (size_t band{ first / raster_band }; band <= last / raster_band; band++) {
+		bins[band].push_back(index);
+	}
+}
+void Scene::_drawPrimitive(Render::Target& target, const Primitive& primitive) {
+	target.id = primitive.id;
+	if (primitive.texture == Render::TextureRegistry::none) {
+		Render::fillTriangle(target, primitive.triangle,
+			primitive.colour, rasteriser);
+	} else {
+		Render::mapTriangle(target, primitive.triangle,
+			textures.sampler(primitive.texture), rasteriser);
+	}
+}
+void Scene::_drawTiles(DrawingWindow& window) {
+	// Binning only pays for itself when there are workers to share
+	// the bands between
+	if (pool->size() == 1) {
+		Render::Target target{ window, depth };
+		if (raster_lighting) target.ids = ids.data();
+		for (const Primitive& primitive : primitives) {
+			this->_drawPrimitive(target, primitive);
+		}
+		if (raster_lighting) this->_lightRows(window, 0, window.height);
+		culled_triangles = target.culled_triangles;
+		culled_pixels = target.culled_pixels;
+		return;
+	}
+
+	const size_t bands{ (window.height + raster_band - 1) / raster_band };
+	if (binned_version != primitives_version || bins.size() != bands) {
+		bins.resize(bands);
+		for (std::vector<size_t>& bin : bins) bin.clear();
+		for (size_t i{ 0 }; i < primitives.size(); i++) this->_binPrimitive(window, i);
+		binned_version = primitives_version;
+	}
+	colour.resize(window.width * window.height);
+
+	// Bins keep submission order and the depth test is the same, so
+	// each band ends up as it would drawing the whole frame serially,
+	// and every drawn pixel is written back to the window exactly once
+	std::atomic<size_t> triangles_culled{ 0 }, pixels_culled{ 0 };
+	pool->run(bands, [&](size_t band) {
+		const size_t y_min{ band * raster_band };
+		const size_t y_max{ std::min(y_min + raster_band, window.height) };
+		uint32_t* band_colour{ colour.data() + window.width * y_min };
+		std::fill(band_colour, band_colour + window.width * (y_max - y_min), 0);
+
+		Render::Target target{ window.width, window.height,
+			0, y_min, window.width, y_max, band_colour, depth };
+		if (raster_lighting) target.ids = ids.data();
+		for (size_t index : bins[band]) {
+			this->_drawPrimitive(target, primitives[index]);
+		}
+		triangles_culled += target.culled_triangles;
+		pixels_culled += target.culled_pixels;
+
+		// Rasterised pixels are always opaque, so a transparent one was
+		// never drawn and the window keeps what it had there
+		for (size_t y{ y_min }; y < y_max; y++) {
+			for (size_t x{ 0 }; x < window.width; x++) {
+				const uint32_t pixel{ band_colour[x + window.width * (y - y_min)] };
+				if (pixel != 0) window.setPixelColour(x, y, pixel);
 			}
+		}
 
-			if (collided) {
-				ray = output - light;
-				auto screen_coords{ this->_transformPoint(window, output, collided_scale) };
-				for (auto mtl : materials) {
-					if (mtl.name.compare(collided_elem.mtl) != 0) continue;
-					if (Render::in(window, glm::vec2{ screen_coords[0], screen_coords[1] })) {
-						Colour colour{ mtl.colour };
-						this->_darken(colour, 
-							this->_brightnessPhong(output,
-								collided_elem, collided_face,
-								global_solution));
-						window.setPixelColour(
-							static_cast<size_t>(screen_coords[0]),
-							static_cast<size_t>(screen_coords[1]),
-							Maths::pack(colour));
-					}
+		// The band's pixels are final once all of its bin is drawn, so
+		// it is lit straight away by the worker that drew it
+		if (raster_lighting) this->_lightRows(window, y_min, y_max);
+	});
+	culled_triangles = triangles_culled;
+	culled_pixels = pixels_culled;
+}
+uint32_t Scene::_shadeRaster(DrawingWindow& window,
+	const glm::mat3& inverse_camera,
+	size_t x, size_t y, uint32_t id) {
+	// The surface is found again where the pixel's ray meets the plane
+	// of its triangle, so it is lit at the same point and with the same
+	// interpolated normal the ray tracer would use there
+	const size_t index{ id - 1u };
+	const Triangle& triangle{ bvh.getTriangle(index) };
+	const Element& elem{ objects.at(triangle.object)
+		.first.getElements().at(triangle.element) };
+	const Face& face{ elem.faces.at(triangle.face) };
+	const float scale{ objects[triangle.object].second };
+	const glm::vec3 ray{ inverse_camera * glm::vec3{
+		(x + 0.5f - (window.width / 2)) / scale,
+		(y + 0.5f - (window.height / 2)) / scale,
+		-1.0f
+	} };
+
+	Hit hit{ 0, 1 / 3.0f, 1 / 3.0f, index };
+	const float facing{ glm::dot(triangle.normal, ray) };
+	if (facing != 0) {
+		hit.t = glm::dot(triangle.normal, triangle.a - camera_pos) / facing;
+		const glm::vec3 w{ camera_pos + hit.t * ray - triangle.a };
+		const float d00{ glm::dot(triangle.e1, triangle.e1) };
+		const float d01{ glm::dot(triangle.e1, triangle.e2) };
+		const float d11{ glm::dot(triangle.e2, triangle.e2) };
+		const float d20{ glm::dot(w, triangle.e1) };
+		const float d21{ glm::dot(w, triangle.e2) };
+		const float denominator{ d00 * d11 - d01 * d01 };
+		if (denominator != 0) {
+			// Pixels along an edge can land just outside it, they are
+			// kept on the triangle
+			hit.u = std::min(std::max((d11 * d20 - d01 * d21) / denominator, 0.0f), 1.0f);
+			hit.v = std::min(std::max((d00 * d21 - d01 * d20) / denominator, 0.0f), 1.0f - hit.u);
+		}
+	}
+
+	const glm::vec4 albedo{ Maths::unpack(window.getPixelColour(x, y)) };
+	Colour colour{ static_cast<int>(albedo[0]),
+		static_cast<int>(albedo[1]),
+		static_cast<int>(albedo[2]) };
+	this->_darken(colour, this->_brightnessAt(
+		triangle.point(hit.u, hit.v), elem, face, hit));
+	return Maths::pack(colour);
+}
+void Scene::_lightRows(DrawingWindow& window,
+	size_t y_min, size_t y_max) {
+	const glm::mat3 inverse_camera{ glm::inverse(calibration * extrinsic) };
+	for (size_t y{ y_min }; y < y_max; y++) {
+		for (size_t x{ 0 }; x < window.width; x++) {
+			const uint32_t id{ ids[x + window.width * y] };
+			if (id == 0) continue;
+			window.setPixelColour(x, y,
+				this->_shadeRaster(window, inverse_camera, x, y, id));
+		}
+	}
+}
+void Scene::_drawRaytraced(DrawingWindow& window,
+	size_t block, size_t traced) {
+	if (objects.empty()) return;
+	const glm::mat3 inverse_camera{ glm::inverse(calibration * extrinsic) };
+	const size_t tiles_x{ (window.width + tile_size - 1) / tile_size };
+	const size_t tiles_y{ (window.height + tile_size - 1) / tile_size };
+	if (antialiasing) samples.resize(window.width * window.height);
+	if (primaries.size() != window.width * window.height) {
+		primaries.assign(window.width * window.height, Primary{ });
+	}
+
+	// Every pixel is traced and written by exactly one tile, so the
+	// image does not depend on which worker picks up which tile
+	pool->run(tiles_x * tiles_y, [&](size_t tile) {
+		const size_t x_min{ (tile % tiles_x) * tile_size };
+		const size_t y_min{ (tile / tiles_x) * tile_size };
+		const size_t x_max{ std::min(x_min + tile_size, window.width) };
+		const size_t y_max{ std::min(y_min + tile_size, window.height) };
+		// The last progressive pass traces every pixel, so packets can
+		// take it, the corners traced by earlier passes are cached and
+		// their lanes are left inactive
+		if (block > 1 || (traced > 0 && !packets)) {
+			this->_traceBlocks(window, inverse_camera,
+				x_min, y_min, x_max, y_max, block, traced);
+			return;
+		}
+		if (packets) {
+			for (size_t y{ y_min }; y < y_max; y += 2) {
+				for (size_t x{ x_min }; x < x_max; x += 2) {
+					this->_tracePacket(window, inverse_camera, x, y);
 				}
 			}
+			return;
+		}
+		for (size_t y{ y_min }; y < y_max; y++) {
+			for (size_t x{ x_min }; x < x_max; x++) {
+				Surface surface;
+				const bool collided{ this->_primary(window,
+					inverse_camera, x, y, surface) };
+				window.setPixelColour(x, y,
+					this->_record(window, x, y, collided, surface));
+			}
 		}
+	});
+}
+void Scene::_tracePacket(DrawingWindow& window,
+	const glm::mat3& inverse_camera,
+	size_t x, size_t y) {
+	// Lanes cover a 2x2 block of pixels, lanes past the edge of the
+	// window or with a cached hit are simply left inactive
+	RayPacket packet{ camera_pos };
+	for (int lane{ 0 }; lane < RayPacket::size; lane++) {
+		const size_t lane_x{ x + lane % 2 };
+		const size_t lane_y{ y + lane / 2 };
+		if (lane_x >= window.width || lane_y >= window.height) continue;
+		if (primaries[lane_y * window.width + lane_x].version == view_version) continue;
+		packet.add(lane, this->_pixelRay(window, inverse_camera,
+			static_cast<float>(lane_x), static_cast<float>(lane_y)));
+	}
+	if (packet.active) bvh.closest(packet);
+	for (int lane{ 0 }; lane < RayPacket::size; lane++) {
+		const size_t lane_x{ x + lane % 2 };
+		const size_t lane_y{ y + lane / 2 };
+		if (lane_x >= window.width || lane_y >= window.height) continue;
+		Primary& primary{ primaries[lane_y * window.width + lane_x] };
+		if (packet.active & (1 << lane)) {
+			primary.collided = (packet.hits & (1 << lane)) != 0;
+			if (primary.collided) primary.surface = this->_surface(packet.hit(lane));
+			primary.version = view_version;
+		}
+		window.setPixelColour(lane_x, lane_y, this->_record(window,
+			lane_x, lane_y, primary.collided, primary.surface));
 	}
 }
-bool Scene::_occluded(const glm::vec3 v,
-	const Element& celem, const Face& cface) {
-	for (const std::pair<Object, float>& pair : objects) {
-		for (const Element& elem : pair.first.getElements()) {
-			const std::vector<glm::vec3>& points{ elem.points };
-			for (const Face& face : elem.faces) {
-				if (elem.name.compare(celem.name) == 0) {
-					if (cface.a == face.a
-						&& cface.b == face.b
-						&& cface.c == face.c) continue;
-				}
-				glm::vec3 s;
-				if (this->_raytrace(light, v - light,
-					points.at(face.a), points.at(face.b),
-					points.at(face.c), &s)) {
-					if (s[0] > 0.01f && s[0] < 1.0f) return true;
+glm::vec3 Scene::_pixelRay(DrawingWindow& window,
+	const glm::mat3& inverse_camera,
+	float x, float y) const {
+	// Inverts the rasterisers' projection through the centre of the pixel so ray
+	// traced frames line up with the rasterised ones, framed by the
+	// draw scale of the first object
+	const float scale{ objects.front().second };
+	return inverse_camera * glm::vec3{
+		(x + 0.5f - (window.width / 2)) / scale,
+		(y + 0.5f - (window.height / 2)) / scale,
+		-1.0f
+	};
+}
+void Scene::_traceBlocks(DrawingWindow& window,
+	const glm::mat3& inverse_camera,
+	size_t x_min, size_t y_min,
+	size_t x_max, size_t y_max,
+	size_t block, size_t traced) {
+	// The pixel at the corner of each block is traced and fills the
+	// block, corners already traced by the coarser pass are kept
+	for (size_t y{ y_min }; y < y_max; y += block) {
+		for (size_t x{ x_min }; x < x_max; x += block) {
+			if (traced > 0 && x % traced == 0 && y % traced == 0) continue;
+			Surface surface;
+			const bool collided{ this->_primary(window,
+				inverse_camera, x, y, surface) };
+			const uint32_t colour{ this->_record(window, x, y, collided, surface) };
+			for (size_t by{ y }; by < std::min(y + block, y_max); by++) {
+				for (size_t bx{ x }; bx < std::min(x + block, x_max); bx++) {
+					window.setPixelColour(bx, by, colour);
 				}
 			}
 		}
 	}
+}
+bool Scene::_primary(DrawingWindow& window,
+	const glm::mat3& inverse_camera,
+	size_t x, size_t y,
+	Surface& surface) {
+	Primary& primary{ primaries[y * window.width + x] };
+	if (primary.version != view_version) {
+		Hit hit;
+		const glm::vec3 ray{ this->_pixelRay(window, inverse_camera,
+			static_cast<float>(x), static_cast<float>(y)) };
+		primary.collided = bvh.closest(camera_pos, ray, hit);
+		if (primary.collided) primary.surface = this->_surface(hit);
+		primary.version = view_version;
+	}
+	surface = primary.surface;
+	return primary.collided;
+}
+Scene::Surface Scene::_surface(const Hit& hit) const {
+	const Triangle& triangle{ bvh.getTriangle(hit.triangle) };
+	return {
+		hit,
+		triangle.point(hit.u, hit.v),
+		element_materials.at(triangle.object).at(triangle.element)
+	};
+}
+uint32_t Scene::_record(DrawingWindow& window,
+	size_t x, size_t y,
+	bool collided, const Surface& surface) {
+	const uint32_t colour{ collided ? this->_shade(surface) : 0 };
+	const Hit& hit{ surface.hit };
+	if (antialiasing) {
+		Sample& sample{ samples[y * window.width + x] };
+		sample.colour = colour;
+		sample.collided = collided;
+		if (collided) {
+			const Triangle& triangle{ bvh.getTriangle(hit.triangle) };
+			sample.t = hit.t;
+			sample.object = triangle.object;
+			sample.element = triangle.element;
+		}
+	}
+	return colour;
+}
+bool Scene::_isEdge(DrawingWindow& window, size_t x, size_t y) const {
+	// Neighbours that hit a different element, sit at a different
+	// depth or differ visibly in colour mark the pixel for subsamples
+	const Sample& sample{ samples[y * window.width + x] };
+	const glm::vec4 colour{ Maths::unpack(sample.colour) };
+	const int offsets[4][2]{ { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+	for (const auto& offset : offsets) {
+		const size_t nx{ x + offset[0] };
+		const size_t ny{ y + offset[1] };
+		if (nx >= window.width || ny >= window.height) continue;
+		const Sample& other{ samples[ny * window.width + nx] };
+		if (sample.collided != other.collided) return true;
+		if (sample.collided) {
+			if (sample.object != other.object
+				|| sample.element != other.element) return true;
+			if (std::abs(sample.t - other.t)
+				> aa_depth * std::min(sample.t, other.t)) return true;
+		}
+		const glm::vec4 difference{ glm::abs(Maths::unpack(other.colour) - colour) };
+		if (std::max(std::max(difference[0], difference[1]), difference[2])
+			> aa_colour) return true;
+	}
 	return false;
 }
-float Scene::_brightness(const glm::vec3 v,
-	const Element& celem, const Face& cface,
+void Scene::_antialias(DrawingWindow& window) {
+	if (objects.empty() || samples.size() != window.width * window.height) return;
+	const glm::mat3 inverse_camera{ glm::inverse(calibration * extrinsic) };
+	const size_t tiles_x{ (window.width + tile_size - 1) / tile_size };
+	const size_t tiles_y{ (window.height + tile_size - 1) / tile_size };
+
+	// Edge pixels are replaced by the mean of a stratified grid of
+	// subsamples, the stored primary samples are left untouched so
+	// every tile sees the same neighbours
+	std::atomic<size_t> edges{ 0 };
+	pool->run(tiles_x * tiles_y, [&](size_t tile) {
+		const size_t x_min{ (tile % tiles_x) * tile_size };
+		const size_t y_min{ (tile / tiles_x) * tile_size };
+		const size_t x_max{ std::min(x_min + tile_size, window.width) };
+		const size_t y_max{ std::min(y_min + tile_size, window.height) };
+		size_t count{ 0 };
+		for (size_t y{ y_min }; y < y_max; y++) {
+			for (size_t x{ x_min }; x < x_max; x++) {
+				if (!this->_isEdge(window, x, y)) continue;
+				glm::vec4 sum{ 0, 0, 0, 0 };
+				for (size_t sy{ 0 }; sy < aa_grid; sy++) {
+					for (size_t sx{ 0 }; sx < aa_grid; sx++) {
+						Hit hit;
+						const glm::vec3 ray{ this->_pixelRay(window, inverse_camera,
+							x + (sx + 0.5f) / aa_grid - 0.5f,
+							y + (sy + 0.5f) / aa_grid - 0.5f) };
+						if (!bvh.closest(camera_pos, ray, hit)) continue;
+						sum += Maths::unpack(this->_shade(this->_surface(hit)));
+					}
+				}
+				sum /= static_cast<float>(aa_grid * aa_grid);
+				window.setPixelColour(x, y, Maths::pack(
+					glm::vec3{ sum[0], sum[1], sum[2] }, sum[3]));
+				count++;
+			}
+		}
+		edges += count;
+	});
+	samples_per_pixel = 1.0f + static_cast<float>(edges * aa_grid * aa_grid)
+		/ (window.width * window.height);
+}
+Colour Scene::_textureColour(const Element& elem,
+	const Face& face, size_t texture,
+	const Hit& hit) const {
+	// The hit weights the face's texture points the same way it weights
+	// its vertices, rays carry no footprint so the full size level is
+	// sampled and kept inside the texture
+	const Render::Sampler& map{ textures.sampler(texture) };
+	const glm::vec2 ta{ elem.texture_points.at(face.ta) };
+	const glm::vec2 tb{ elem.texture_points.at(face.tb) };
+	const glm::vec2 tc{ elem.texture_points.at(face.tc) };
+	const glm::vec2 uv{ ta + hit.u * (tb - ta) + hit.v * (tc - ta) };
+	const glm::vec4 texel{ Maths::unpack(Render::sampleTexture(map,
+		std::min(std::max(uv[0] * map.width, 0.0f), map.width - 1.0f),
+		std::min(std::max(uv[1] * map.height, 0.0f), map.height - 1.0f))) };
+	return Colour{ static_cast<int>(texel[0]),
+		static_cast<int>(texel[1]),
+		static_cast<int>(texel[2]) };
+}
+uint32_t Scene::_shade(const Surface& surface) {
+	const Triangle& triangle{ bvh.getTriangle(surface.hit.triangle) };
+	const Element& elem{ objects.at(triangle.object)
+		.first.getElements().at(triangle.element) };
+	const Face& face{ elem.faces.at(triangle.face) };
+
+	Colour colour{ 0, 0, 0 };
+	if (surface.material < materials.size()) {
+		const Material& material{ materials[surface.material] };
+		colour = material.type == MaterialType::TEXTURE
+			? this->_textureColour(elem, face, material.texture, surface.hit)
+			: material.colour;
+	}
+	this->_darken(colour, this->_brightnessAt(
+		surface.position, elem, face, surface.hit));
+	return Maths::pack(colour);
+}
+bool Scene::_occluded(const glm::vec3 v, size_t triangle) {
+	// The ray runs from the light and stops at v, so any hit in
+	// between blocks it, the shaded triangle is skipped by its id
+	return bvh.occluded(light, v - light, 0.01f, 1.0f, triangle);
+}
+float Scene::_brightness(const glm::vec3 v, size_t triangle,
 	const glm::vec3 normal) {
+	return this->_brightness(v, normal, this->_occluded(v, triangle));
+}
+float Scene::_brightness(const glm::vec3 v,
+	const glm::vec3 normal, bool occluded) const {
 	auto ray{ v - light };
 	auto ray_length{ glm::length(ray) };
 
@@ -271,7 +603,7 @@ float Scene::_brightness(const glm::vec3 v,
 
 	// Brightness
 	float brightness{ 1.0f };
-	if (this->_occluded(v, celem, cface)) {
+	if (occluded) {
 		brightness = ambient_light;
 	} else {
 		brightness *= specular;
@@ -284,46 +616,57 @@ float Scene::_brightness(const glm::vec3 v,
 }
 float Scene::_brightnessPhong(const glm::vec3 v,
 	const Element& celem, const Face& cface,
-	const glm::vec3 solution) {
-	glm::vec3 na{ 0, 0, 0 };
-	glm::vec3 nb{ 0, 0, 0 };
-	glm::vec3 nc{ 0, 0, 0 };
-	for (const Face& f : celem.faces) {
-		for (auto p : { f.a, f.b, f.c }) {
-			if (p == cface.a) na += f.normal;
-			if (p == cface.b) nb += f.normal;
-			if (p == cface.c) nc += f.normal;
-		}
-	}
+	const Hit& hit) {
 	return this->_brightness(v,
-		celem, cface, glm::normalize(
-			(na * (1 - solution[1] - solution[2]))
-			+ (nb * solution[1])
-			+ (nc * solution[2])
+		hit.triangle, glm::normalize(
+			(celem.normals.at(cface.a) * (1 - hit.u - hit.v))
+			+ (celem.normals.at(cface.b) * hit.u)
+			+ (celem.normals.at(cface.c) * hit.v)
 		));
 }
 float Scene::_brightnessGouraud(const glm::vec3 v,
 	const Element& celem, const Face& cface,
-	const glm::vec3 solution) {
-	glm::vec3 na{ 0, 0, 0 };
-	glm::vec3 nb{ 0, 0, 0 };
-	glm::vec3 nc{ 0, 0, 0 };
-	for (const Face& f : celem.faces) {
-		for (auto p : { f.a, f.b, f.c }) {
-			if (p == cface.a) na += f.normal;
-			if (p == cface.b) nb += f.normal;
-			if (p == cface.c) nc += f.normal;
+	const Hit& hit) {
+	const Triangle& triangle{ bvh.getTriangle(hit.triangle) };
+	const float* brightness{ vertex_brightness.data()
+		+ vertex_offsets[triangle.object][triangle.element] };
+	return (brightness[cface.a] * (1 - hit.u - hit.v))
+		+ (brightness[cface.b] * hit.u)
+		+ (brightness[cface.c] * hit.v);
+}
+float Scene::_brightnessAt(const glm::vec3 v,
+	const Element& celem, const Face& cface,
+	const Hit& hit) {
+	return shading == Shading::GOURAUD
+		? this->_brightnessGouraud(v, celem, cface, hit)
+		: this->_brightnessPhong(v, celem, cface, hit);
+}
+void Scene::_lightVertices() {
+	if (lit_version == lighting_version) return;
+
+	// A vertex lies on every face meeting there, so rather than skip
+	// one of them its shadow ray stops just short of it, an index past
+	// the last triangle then skips none
+	const bool shadows{ shadowed_version != shadow_version };
+	const size_t chunk{ 256 };
+	const size_t none{ bvh.getTriangleCount() };
+	vertex_brightness.resize(vertices.size());
+	vertex_shadowed.resize(vertices.size());
+	pool->run((vertices.size() + chunk - 1) / chunk, [&](size_t task) {
+		const size_t last{ std::min((task + 1) * chunk, vertices.size()) };
+		for (size_t i{ task * chunk }; i < last; i++) {
+			const Vertex& vertex{ vertices[i] };
+			if (shadows) {
+				vertex_shadowed[i] = this->_occluded(vertex.position
+					+ shadow_bias * glm::normalize(light - vertex.position),
+					none);
+			}
+			vertex_brightness[i] = this->_brightness(vertex.position,
+				vertex.normal, vertex_shadowed[i] != 0);
 		}
-	}
-	float a{ this->_brightness(celem.points.at(cface.a), 
-		celem, cface, glm::normalize(na)) };
-	float b{ this->_brightness(celem.points.at(cface.b), 
-		celem, cface, glm::normalize(nb)) };
-	float c{ this->_brightness(celem.points.at(cface.c), 
-		celem, cface, glm::normalize(nc)) };
-	return (a * (1 - solution[1] - solution[2]))
-		+ (b * solution[1])
-		+ (c * solution[2]);
+	});
+	shadowed_version = shadow_version;
+	lit_version = lighting_version;
 }
 void Scene::_darken(Colour& c, float f) {
 	c.red = static_cast<int>(c.red * f);
@@ -333,28 +676,153 @@ void Scene::_darken(Colour& c, float f) {
 
 void Scene::translate(glm::vec3 v) {
 	camera_pos += v;
+	this->_invalidate();
 }
 void Scene::rotateCamera(glm::vec3 r) {
 	extrinsic = Maths::rotateZ(r[2])
 		* Maths::rotateY(r[1])
 		* Maths::rotateX(r[0])
 		* extrinsic;
+	this->_invalidate();
 }
 void Scene::rotateWorld(glm::vec3 r) {
 	camera_pos = Maths::rotateZ(r[2])
 		* Maths::rotateY(r[1])
 		* Maths::rotateX(r[0])
 		* camera_pos;
+	this->_invalidate();
 }
 void Scene::lookAt(glm::vec3 l) {
 	glm::vec3 z{ glm::normalize(camera_pos - l) };
 	glm::vec3 x{ glm::normalize(glm::cross({ 0.0f, 1.0f, 0.0f }, z)) };
 	glm::vec3 y{ glm::normalize(glm::cross(x, z)) };
 	extrinsic = glm::inverse(glm::mat3{ x, y, z });
+	this->_invalidate();
 }
 
 void Scene::setRenderMode(RenderMode mode) {
 	this->renderMode = mode;
+	this->restart();
+}
+void Scene::setRasteriser(Rasteriser rasteriser) {
+	this->rasteriser = rasteriser;
+	dirty = true;
+}
+Rasteriser Scene::getRasteriser() const {
+	return rasteriser;
+}
+void Scene::setTextureLayout(TextureLayout layout) {
+	textures.setLayout(layout);
+	dirty = true;
+}
+TextureLayout Scene::getTextureLayout() const {
+	return textures.getLayout();
+}
+void Scene::setTextureFilter(TextureFilter filter) {
+	textures.setFilter(filter);
+	this->restart();
+}
+TextureFilter Scene::getTextureFilter() const {
+	return textures.getFilter();
+}
+void Scene::setMipmapping(bool mipmapping) {
+	textures.setMipmapping(mipmapping);
+	dirty = true;
+}
+bool Scene::getMipmapping() const {
+	return textures.getMipmapping();
+}
+void Scene::setRasterLighting(bool lighting) {
+	this->raster_lighting = lighting;
+	dirty = true;
+}
+bool Scene::getRasterLighting() const {
+	return raster_lighting;
+}
+void Scene::setShading(Shading shading) {
+	this->shading = shading;
+	this->restart();
+}
+Shading Scene::getShading() const {
+	return shading;
+}
+void Scene::setPacketTracing(bool packets) {
+	this->packets = packets;
+}
+bool Scene::getPacketTracing() const {
+	return packets;
+}
+void Scene::setThreads(size_t threads) {
+	pool.reset(new ThreadPool{ threads });
+}
+void Scene::setProgressive(bool progressive) {
+	this->progressive = progressive;
+	this->restart();
+}
+bool Scene::getProgressive() const {
+	return progressive;
+}
+bool Scene::isAccumulating() const {
+	return progressive && renderMode == RenderMode::RAYTRACED;
+}
+void Scene::setAntialiasing(bool antialiasing) {
+	this->antialiasing = antialiasing;
+	this->restart();
+}
+bool Scene::getAntialiasing() const {
+	return antialiasing;
+}
+float Scene::getSamplesPerPixel() const {
+	return antialiasing ? samples_per_pixel : 1.0f;
+}
+size_t Scene::getCulledTriangles() const {
+	return culled_triangles;
+}
+size_t Scene::getCulledPixels() const {
+	return culled_pixels;
+}
+void Scene::restart() {
+	block = preview_block;
+	antialiased = false;
+	dirty = true;
+}
+bool Scene::needsDraw() const {
+	// Progressive frames carry on refining after a change until they
+	// reach full resolution and, if asked for, anti-aliasing
+	if (dirty) return true;
+	if (renderMode != RenderMode::RAYTRACED || !progressive) return false;
+	return block > 0 || (antialiasing && !antialiased);
+}
+void Scene::_invalidate() {
+	view_version++;
+	lighting_version++;
+	this->restart();
+}
+
+void Scene::setLight(glm::vec3 light) {
+	this->light = light;
+	lighting_version++;
+	shadow_version++;
+	this->restart();
+}
+glm::vec3 Scene::getLight() const {
+	return light;
+}
+void Scene::moveLight(glm::vec3 v) {
+	this->setLight(light + v);
+}
+void Scene::setLightStrength(float strength) {
+	this->light_strength = strength;
+	lighting_version++;
+	this->restart();
+}
+float Scene::getLightStrength() const {
+	return light_strength;
+}
+void Scene::setSpecularPower(float power) {
+	this->specular_power = power;
+	lighting_version++;
+	this->restart();
 }
 
 void Scene::loadObject(std::string name,
@@ -365,6 +833,58 @@ void Scene::loadObject(std::string name,
 		: objects.back().first.getMaterialDependencies()) {
 		this->_loadMaterials(mtl_name);
 	}
+	this->_resolveMaterials();
+	bvh.build(objects);
+	this->_indexTriangles();
+	this->_indexVertices();
+	shadow_version++;
+	this->_invalidate();
+}
+void Scene::_resolveMaterials() {
+	// Material names are matched once here, an element without a
+	// material gets an index past the end and shades black
+	element_materials.clear();
+	for (const std::pair<Object, float>& pair : objects) {
+		std::vector<size_t> indices{ };
+		for (const Element& elem : pair.first.getElements()) {
+			size_t index{ 0 };
+			while (index < materials.size()
+				&& materials[index].name.compare(elem.mtl) != 0) index++;
+			indices.push_back(index);
+		}
+		element_materials.push_back(indices);
+	}
+}
+void Scene::_indexTriangles() {
+	// The BVH reorders its triangles while building, so every face is
+	// looked up here once to find where it ended up
+	face_ids.clear();
+	for (const std::pair<Object, float>& pair : objects) {
+		std::vector<std::vector<uint32_t>> element_ids{ };
+		for (const Element& elem : pair.first.getElements()) {
+			element_ids.emplace_back(elem.faces.size(), 0);
+		}
+		face_ids.push_back(element_ids);
+	}
+	for (size_t i{ 0 }; i < bvh.getTriangleCount(); i++) {
+		const Triangle& triangle{ bvh.getTriangle(i) };
+		face_ids[triangle.object][triangle.element][triangle.face]
+			= static_cast<uint32_t>(i + 1);
+	}
+}
+void Scene::_indexVertices() {
+	vertices.clear();
+	vertex_offsets.clear();
+	for (const std::pair<Object, float>& pair : objects) {
+		std::vector<size_t> offsets{ };
+		for (const Element& elem : pair.first.getElements()) {
+			offsets.push_back(vertices.size());
+			for (size_t i{ 0 }; i < elem.points.size(); i++) {
+				vertices.push_back({ elem.points[i], elem.normals[i] });
+			}
+		}
+		vertex_offsets.push_back(offsets);
+	}
 }
 void Scene::_loadMaterials(const std::string filename) {
 	std::ifstream stream(filename, std::ifstream::binary);
@@ -385,11 +905,7 @@ void Scene::_loadMaterials(const std::string filename) {
 		}
 		if (line.rfind("map_Kd ", 0) == 0) {
 			mat.type = MaterialType::TEXTURE;
-			mat.texture = line.substr(7);
-			textures.push_back(std::make_pair(
-				mat.texture,
-				TextureMap{ mat.texture }
-			));
+			mat.texture = textures.load(line.substr(7));
 		}
 	}
 	if (!mat.name.empty()) materials.push_back(mat);
@@ -1,19 +1,116 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include <glm/glm.hpp>
 
-#include <TextureMap.h>
 #include <DrawingWindow.h>
 
+#include "bvh.hpp"
+#include "clip.hpp"
+#include "pool.hpp"
 #include "render.hpp"
 #include "object.hpp"
+#include "texture.hpp"
 
 class Scene {
 private:
 
 	RenderMode renderMode{ RenderMode::WIRE };
+	Rasteriser rasteriser{ Rasteriser::SCANLINE };
+
+	// Set by anything that changes what the next frame shows, and
+	// cleared once a frame has been drawn
+	bool dirty{ true };
+
+	const size_t tile_size{ 16 };
+	bool packets{ false };
+
+	// Every element's transformed points are kept until the view or the
+	// window changes, and so are the primitives set up and binned from
+	// them, so frames from a still camera go straight to rasterising
+	struct Transformed {
+		std::vector<glm::vec3> camera{ };
+		std::vector<glm::vec3> screen{ };
+	};
+	glm::mat4 view{ };
+	std::vector<std::vector<Transformed>> transformed{ };
+	size_t setup_width{ 0 }, setup_height{ 0 };
+	size_t transformed_version{ 0 };
+	size_t primitives_version{ 0 };
+	size_t binned_version{ 0 };
+
+	// RASTER frames are drawn sort-middle, triangles are set up in
+	// submission order, binned by bounding box and every tile is then
+	// rasterised against its own rows of the colour and depth buffers,
+	// tiles are full-width bands so no scanline is split between them
+	struct Primitive {
+		CanvasTriangle triangle{ };
+		uint32_t colour{ 0 };
+		size_t texture{ Render::TextureRegistry::none };
+		uint32_t id{ 0 };
+	};
+	static constexpr size_t raster_band{ 32 };
+	// Bands sharing the depth buffer's blocks would race on them
+	static_assert(raster_band % Render::DepthBuffer::block == 0,
+		"raster bands must be whole depth blocks high");
+	std::vector<Primitive> primitives{ };
+	std::vector<std::vector<size_t>> bins{ };
+	std::vector<uint32_t> colour{ };
+
+	// Lit RASTER frames are shaded deferred, rasterising leaves the
+	// unlit colour, depth and the id of the visible triangle for each
+	// pixel and one screen space pass then lights every covered pixel
+	// once, however many fragments were drawn over it, ids are one past
+	// the triangle's index in the BVH
+	bool raster_lighting{ true };
+	std::vector<uint32_t> ids{ };
+	std::vector<std::vector<std::vector<uint32_t>>> face_ids{ };
+
+	// Triangles and bounding box pixels the hierarchical depth let the
+	// last RASTER frame skip, a triangle culled in several bands counts
+	// once for each
+	size_t culled_triangles{ 0 };
+	size_t culled_pixels{ 0 };
+
+	// Progressive passes trace one pixel per block, halving the block
+	// size each frame, block == 0 once the full resolution is drawn
+	const size_t preview_block{ 8 };
+	bool progressive{ false };
+	size_t block{ 0 };
+
+	// Adaptive anti-aliasing keeps the primary sample of every pixel
+	// and supersamples the pixels that differ from a neighbour
+	struct Sample {
+		uint32_t colour{ 0 };
+		float t{ 0 };
+		size_t object{ 0 }, element{ 0 };
+		bool collided{ false };
+	};
+	const size_t aa_grid{ 4 };
+	const int aa_colour{ 16 };
+	const float aa_depth{ 0.05f };
+	bool antialiasing{ false };
+	bool antialiased{ false };
+	float samples_per_pixel{ 1.0f };
+	std::vector<Sample> samples{ };
+
+	// Primary hits are cached per pixel and stamped with the view
+	// version, so changes to lighting alone only re-run shading
+	struct Surface {
+		Hit hit{ };
+		glm::vec3 position{ };
+		size_t material{ 0 };
+	};
+	struct Primary {
+		Surface surface{ };
+		bool collided{ false };
+		size_t version{ 0 };
+	};
+	size_t view_version{ 1 };
+	std::vector<Primary> primaries{ };
+	std::unique_ptr<ThreadPool> pool{ new ThreadPool{ 1 } };
 
 	enum class MaterialType { COLOUR, TEXTURE };
 	struct Material {
@@ -21,8 +118,9 @@ private:
 		MaterialType type{ MaterialType::COLOUR };
 
 		Colour colour{ 0, 0, 0 };
-		std::string texture{ };
+		size_t texture{ Render::TextureRegistry::none };
 	};
+	const Material missing_material{ "" };
 
 	glm::vec3 camera_pos{ 0.0f, 0.0f, 0.0f };
 	glm::mat3 calibration{ 
@@ -35,7 +133,27 @@ private:
 		glm::vec3{ 0.0f, -1.0f, 0.0f },
 		glm::vec3{ 0.0f, 0.0f, 1.0f }
 	};
-	std::vector<float> depth{ };
+	Render::DepthBuffer depth{ };
+
+	// Gouraud shading lights every vertex once and interpolates between
+	// them, brightnesses are kept element by element in one flat list
+	// until the light or the camera moves, and the ray tracer and lit
+	// RASTER frames both read them, shadow rays only depend on the
+	// light so they are kept until it moves
+	struct Vertex {
+		glm::vec3 position{ };
+		glm::vec3 normal{ };
+	};
+	Shading shading{ Shading::PHONG };
+	const float shadow_bias{ 0.001f };
+	std::vector<Vertex> vertices{ };
+	std::vector<std::vector<size_t>> vertex_offsets{ };
+	std::vector<float> vertex_brightness{ };
+	std::vector<uint8_t> vertex_shadowed{ };
+	size_t lighting_version{ 1 };
+	size_t lit_version{ 0 };
+	size_t shadow_version{ 1 };
+	size_t shadowed_version{ 0 };
 
 	float specular_power{ 16.0f };
 	float specular_cull{ 0.8f };
@@ -43,61 +161,95 @@ private:
 	const float ambient_light{ 0.05f };
 	glm::vec3 light{ -0.2f, 0.8f, 0.5f };
 	//glm::vec3 light{ 0, 1.2f, 0 };
-	bool _occluded(const glm::vec3 v, 
-		const Element& celem, const Face& cface);
+	bool _occluded(const glm::vec3 v, size_t triangle);
 	float _brightnessPhong(const glm::vec3 v,
 		const Element& celem, const Face& cface,
-		const glm::vec3 solution);
+		const Hit& hit);
 	float _brightnessGouraud(const glm::vec3 v, 
 		const Element& celem, const Face& cface,
-		const glm::vec3 solution);
+		const Hit& hit);
+	float _brightness(const glm::vec3 v, size_t triangle,
+		const glm::vec3 normal);
 	float _brightness(const glm::vec3 v,
+		const glm::vec3 normal, bool occluded) const;
+	float _brightnessAt(const glm::vec3 v,
 		const Element& celem, const Face& cface,
-		const glm::vec3 normal);
+		const Hit& hit);
+	void _lightVertices();
 	void _darken(Colour& c, float f);
 
-	std::vector<std::pair<std::string, TextureMap>> textures{ };
+	Render::TextureRegistry textures{ };
 	std::vector<std::pair<Object, float>> objects{ };
 	std::vector<Material> materials{ };
+	std::vector<std::vector<size_t>> element_materials{ };
+	BVH bvh{ };
 	void _loadMaterials(const std::string filename);
+	void _resolveMaterials();
+	void _indexTriangles();
+	void _indexVertices();
+	void _invalidate();
 
 	glm::mat4 _getExtrinsicMatrix() const;
-	glm::vec3 _transformPoint(DrawingWindow& w, 
-		glm::vec3 p, float scale);
-	void _transformPoints(DrawingWindow& w,
-		float scale,
-		std::vector<glm::vec3> p,
-		std::vector<glm::vec3>& out);
 
 	void _facePoints(const Face& face,
-		const std::vector<glm::vec3> points,
+		const std::vector<glm::vec3>& points,
 		CanvasPoint& a,
 		CanvasPoint& b,
 		CanvasPoint& c);
 	void _faceTexturePoints(const Face& face,
-		const std::vector<glm::vec2> texture_points,
-		const TextureMap& map,
+		const std::vector<glm::vec2>& texture_points,
+		const Render::Sampler& map,
 		CanvasPoint& a,
 		CanvasPoint& b,
 		CanvasPoint& c);
 
-	bool _raytrace(const glm::vec3& from,
-		const glm::vec3& ray,
-		const glm::vec3& a,
-		const glm::vec3& b,
-		const glm::vec3& c,
-		glm::vec3* sr = nullptr,
-		glm::vec3* ur = nullptr,
-		glm::vec3* vr = nullptr) const;
-
 	void _drawWire(DrawingWindow& window,
 		const Element& elem,
 		const std::vector<glm::vec3>& points);
-	void _drawRaster(DrawingWindow& window, 
-		const Element& elem, 
-		const std::vector<glm::vec3>& points, 
+	void _transformElements(DrawingWindow& window);
+	void _setupRaster(DrawingWindow& window);
+	void _drawRaster(const Render::Clipper& clipper,
+		const Element& elem,
+		const std::vector<glm::vec3>& camera,
+		const std::vector<glm::vec3>& points,
+		const std::vector<uint32_t>& element_ids,
 		const Material& material);
-	void _drawRaytraced(DrawingWindow& window);
+	void _binPrimitive(DrawingWindow& window, size_t index);
+	void _drawPrimitive(Render::Target& target,
+		const Primitive& primitive);
+	void _drawTiles(DrawingWindow& window);
+	uint32_t _shadeRaster(DrawingWindow& window,
+		const glm::mat3& inverse_camera,
+		size_t x, size_t y, uint32_t id);
+	void _lightRows(DrawingWindow& window,
+		size_t y_min, size_t y_max);
+	glm::vec3 _pixelRay(DrawingWindow& window,
+		const glm::mat3& inverse_camera,
+		float x, float y) const;
+	void _tracePacket(DrawingWindow& window,
+		const glm::mat3& inverse_camera,
+		size_t x, size_t y);
+	void _traceBlocks(DrawingWindow& window,
+		const glm::mat3& inverse_camera,
+		size_t x_min, size_t y_min,
+		size_t x_max, size_t y_max,
+		size_t block, size_t traced);
+	bool _primary(DrawingWindow& window,
+		const glm::mat3& inverse_camera,
+		size_t x, size_t y,
+		Surface& surface);
+	Surface _surface(const Hit& hit) const;
+	Colour _textureColour(const Element& elem,
+		const Face& face, size_t texture,
+		const Hit& hit) const;
+	uint32_t _shade(const Surface& surface);
+	uint32_t _record(DrawingWindow& window,
+		size_t x, size_t y,
+		bool collided, const Surface& surface);
+	bool _isEdge(DrawingWindow& window, size_t x, size_t y) const;
+	void _antialias(DrawingWindow& window);
+	void _drawRaytraced(DrawingWindow& window,
+		size_t block, size_t traced);
 
 public:
 
@@ -112,6 +264,38 @@ public:
 	void lookAt(glm::vec3 l);
 
 	void setRenderMode(RenderMode mode);
+	void setRasteriser(Rasteriser rasteriser);
+	Rasteriser getRasteriser() const;
+	void setTextureLayout(TextureLayout layout);
+	TextureLayout getTextureLayout() const;
+	void setTextureFilter(TextureFilter filter);
+	TextureFilter getTextureFilter() const;
+	void setMipmapping(bool mipmapping);
+	bool getMipmapping() const;
+	void setRasterLighting(bool lighting);
+	bool getRasterLighting() const;
+	void setShading(Shading shading);
+	Shading getShading() const;
+	void setPacketTracing(bool packets);
+	bool getPacketTracing() const;
+	void setThreads(size_t threads);
+	void setProgressive(bool progressive);
+	bool getProgressive() const;
+	bool isAccumulating() const;
+	void setAntialiasing(bool antialiasing);
+	bool getAntialiasing() const;
+	float getSamplesPerPixel() const;
+	size_t getCulledTriangles() const;
+	size_t getCulledPixels() const;
+	void restart();
+	bool needsDraw() const;
+
+	void setLight(glm::vec3 light);
+	glm::vec3 getLight() const;
+	void moveLight(glm::vec3 v);
+	void setLightStrength(float strength);
+	float getLightStrength() const;
+	void setSpecularPower(float power);
 
 	void loadObject(std::string name, 
 		float load_scale, float draw_scale);
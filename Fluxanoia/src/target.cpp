@@ -0,0 +1,22 @@
+#include "target.hpp"
+
+Render::Target::Target(DrawingWindow& window, std::vector<float>* depth)
+	: width{ window.width }, height{ window.height },
+	x_max{ window.width }, y_max{ window.height },
+	window{ &window },
+	depth{ depth == nullptr ? nullptr : depth->data() },
+	stride{ window.width } { }
+Render::Target::Target(DrawingWindow& window, DepthBuffer& depth)
+	: width{ window.width }, height{ window.height },
+	x_max{ window.width }, y_max{ window.height },
+	window{ &window },
+	depth{ depth.data() }, hiz{ &depth },
+	stride{ window.width } { }
+Render::Target::Target(size_t width, size_t height,
+	size_t x_min, size_t y_min,
+	size_t x_max, size_t y_max,
+	uint32_t* colour, DepthBuffer& depth)
+	: width{ width }, height{ height },
+	x_min{ x_min }, y_min{ y_min }, x_max{ x_max }, y_max{ y_max },
+	colour{ colour }, depth{ depth.data() }, hiz{ &depth },
+	stride{ x_max - x_min } { }
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <DrawingWindow.h>
+
+#include "depth.hpp"
+
+namespace Render {
+
+	// Where rasterised pixels go, either the window itself or a tile of
+	// it with its own colour buffer, pixels outside the rectangle
+	// [x_min, x_max) x [y_min, y_max) are clipped, depth always covers
+	// the whole window
+	struct Target {
+		size_t width{ 0 }, height{ 0 };
+		size_t x_min{ 0 }, y_min{ 0 }, x_max{ 0 }, y_max{ 0 };
+
+		DrawingWindow* window{ nullptr };
+		uint32_t* colour{ nullptr };
+		float* depth{ nullptr };
+		DepthBuffer* hiz{ nullptr };
+		size_t stride{ 0 };
+
+		// When set, every drawn pixel also records the id of the triangle
+		// being drawn, over the whole window like depth, 0 is left for
+		// pixels nothing was drawn to
+		uint32_t* ids{ nullptr };
+		uint32_t id{ 0 };
+
+		// Work skipped through the hierarchical depth, culled pixels
+		// are counted over bounding boxes rather than coverage
+		size_t culled_triangles{ 0 };
+		size_t culled_pixels{ 0 };
+
+		explicit Target(DrawingWindow& window, std::vector<float>* depth = nullptr);
+		Target(DrawingWindow& window, DepthBuffer& depth);
+		Target(size_t width, size_t height,
+			size_t x_min, size_t y_min,
+			size_t x_max, size_t y_max,
+			uint32_t* colour, DepthBuffer& depth);
+
+		// Clips to the rectangle and runs the depth test, the depth is
+		// stored when it passes
+		bool test(size_t x, size_t y, float z);
+		void setPixel(size_t x, size_t y, uint32_t c);
+	};
+
+	// Both are called for every rasterised pixel, so they are defined
+	// here where the rasterisers can inline them
+	inline bool Target::test(size_t x, size_t y, float z) {
+		if (x < x_min || x >= x_max || y < y_min || y >= y_max) return false;
+		if (depth == nullptr) return true;
+		float& stored{ depth[x + width * y] };
+		if (stored > z) return false;
+		stored = z;
+		return true;
+	}
+	inline void Target::setPixel(size_t x, size_t y, uint32_t c) {
+		if (colour == nullptr) {
+			window->setPixelColour(x, y, c);
+		} else {
+			colour[(y - y_min) * stride + (x - x_min)] = c;
+		}
+		if (ids != nullptr) ids[x + width * y] = id;
+	}
+
+};
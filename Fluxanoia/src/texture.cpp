@@ -0,0 +1,132 @@
+#include "texture.hpp"
+
+#include <algorithm>
+
+Render::Sampler::Sampler() { }
+Render::Sampler::Sampler(const TextureMap& map)
+	: pixels{ map.pixels.data() },
+	width{ map.width }, height{ map.height } { }
+Render::Sampler::Sampler(const uint32_t* pixels,
+	size_t width, size_t height,
+	TextureLayout layout)
+	: pixels{ pixels }, width{ width }, height{ height },
+	layout{ layout }, tiles_x{ (width + tile - 1) / tile } { }
+
+size_t Render::TextureRegistry::load(const std::string& filename) {
+	for (size_t handle{ 0 }; handle < names.size(); handle++) {
+		if (names[handle].compare(filename) == 0) return handle;
+	}
+
+	// The textures live on the heap so the samplers' pointers stay
+	// valid as more textures are added
+	names.push_back(filename);
+	textures.push_back(std::unique_ptr<Texture>{ new Texture{ } });
+	Texture& texture{ *textures.back() };
+	texture.map.reset(new TextureMap{ filename });
+	this->_mipmap(texture);
+	if (layout == TextureLayout::TILED) this->_tile(texture);
+	return names.size() - 1;
+}
+void Render::TextureRegistry::_mipmap(Texture& texture) {
+	texture.samplers.push_back(Sampler{ *texture.map });
+	const uint32_t* source{ texture.map->pixels.data() };
+	size_t width{ texture.map->width }, height{ texture.map->height };
+	while (width > 1 || height > 1) {
+		const size_t level_width{ std::max(width / 2, size_t{ 1 }) };
+		const size_t level_height{ std::max(height / 2, size_t{ 1 }) };
+		texture.levels.push_back(std::vector<uint32_t>(level_width * level_height));
+		std::vector<uint32_t>& level{ texture.levels.back() };
+
+		// Each texel averages the 2x2 texels under it channel by channel,
+		// a side of one texel is averaged with itself
+		for (size_t y{ 0 }; y < level_height; y++) {
+			const size_t y_0{ std::min(2 * y, height - 1) };
+			const size_t y_1{ std::min(2 * y + 1, height - 1) };
+			for (size_t x{ 0 }; x < level_width; x++) {
+				const size_t x_0{ std::min(2 * x, width - 1) };
+				const size_t x_1{ std::min(2 * x + 1, width - 1) };
+				const uint32_t texels[4]{
+					source[x_0 + width * y_0], source[x_1 + width * y_0],
+					source[x_0 + width * y_1], source[x_1 + width * y_1] };
+				uint32_t texel{ 0 };
+				for (uint32_t shift{ 0 }; shift < 32; shift += 8) {
+					uint32_t sum{ 2 };
+					for (uint32_t t : texels) sum += (t >> shift) & 0xFF;
+					texel |= (sum / 4) << shift;
+				}
+				level[x + level_width * y] = texel;
+			}
+		}
+		texture.samplers.push_back(Sampler{ level.data(),
+			level_width, level_height, TextureLayout::LINEAR });
+		source = level.data();
+		width = level_width;
+		height = level_height;
+	}
+	this->_link(texture.samplers);
+}
+void Render::TextureRegistry::_tile(Texture& texture) {
+	if (!texture.tiled.empty()) return;
+	const size_t tile{ Sampler::tile };
+	for (const Sampler& linear : texture.samplers) {
+		// Edge tiles are padded out, the padding is never addressed
+		const size_t tiles_x{ (linear.width + tile - 1) / tile };
+		const size_t tiles_y{ (linear.height + tile - 1) / tile };
+		texture.tiled.push_back(std::vector<uint32_t>(tiles_x * tiles_y * tile * tile, 0));
+		std::vector<uint32_t>& pixels{ texture.tiled.back() };
+		Sampler sampler{ pixels.data(),
+			linear.width, linear.height, TextureLayout::TILED };
+		for (size_t y{ 0 }; y < linear.height; y++) {
+			for (size_t x{ 0 }; x < linear.width; x++) {
+				pixels[sampler.index(x, y)] = linear.pixels[x + linear.width * y];
+			}
+		}
+		texture.tiled_samplers.push_back(sampler);
+	}
+	this->_link(texture.tiled_samplers);
+}
+void Render::TextureRegistry::_link(std::vector<Sampler>& samplers) {
+	for (size_t level{ 0 }; level < samplers.size(); level++) {
+		samplers[level].filter = filter;
+		if (level + 1 < samplers.size()) samplers[level].next = &samplers[level + 1];
+	}
+	if (!mipmapping && !samplers.empty()) samplers.front().next = nullptr;
+}
+
+const Render::Sampler& Render::TextureRegistry::sampler(size_t handle) const {
+	const Texture& texture{ *textures.at(handle) };
+	return layout == TextureLayout::TILED
+		? texture.tiled_samplers.front() : texture.samplers.front();
+}
+size_t Render::TextureRegistry::size() const {
+	return textures.size();
+}
+
+void Render::TextureRegistry::setLayout(TextureLayout layout) {
+	this->layout = layout;
+	if (layout != TextureLayout::TILED) return;
+	for (auto& texture : textures) this->_tile(*texture);
+}
+TextureLayout Render::TextureRegistry::getLayout() const {
+	return layout;
+}
+void Render::TextureRegistry::setFilter(TextureFilter filter) {
+	this->filter = filter;
+	for (auto& texture : textures) {
+		this->_link(texture->samplers);
+		this->_link(texture->tiled_samplers);
+	}
+}
+TextureFilter Render::TextureRegistry::getFilter() const {
+	return filter;
+}
+void Render::TextureRegistry::setMipmapping(bool mipmapping) {
+	this->mipmapping = mipmapping;
+	for (auto& texture : textures) {
+		this->_link(texture->samplers);
+		this->_link(texture->tiled_samplers);
+	}
+}
+bool Render::TextureRegistry::getMipmapping() const {
+	return mipmapping;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <TextureMap.h>
+
+// Row-major textures are read a row at a time, tiled ones keep every
+// 4x4 block of texels together so samples walking down or across a
+// texture stay in the same cache lines
+enum class TextureLayout { LINEAR, TILED };
+enum class TextureFilter { NEAREST, BILINEAR };
+
+namespace Render {
+
+	// A view of a texture's pixels, it owns nothing so passing one
+	// around never copies the texture, mipmapped textures link each
+	// level to the next smaller one
+	struct Sampler {
+		static const size_t tile{ 4 };
+
+		const uint32_t* pixels{ nullptr };
+		size_t width{ 0 }, height{ 0 };
+		TextureLayout layout{ TextureLayout::LINEAR };
+		size_t tiles_x{ 0 };
+		TextureFilter filter{ TextureFilter::NEAREST };
+		const Sampler* next{ nullptr };
+
+		Sampler();
+		Sampler(const TextureMap& map);
+		Sampler(const uint32_t* pixels,
+			size_t width, size_t height,
+			TextureLayout layout);
+
+		size_t index(size_t x, size_t y) const;
+	};
+
+	// Called for every textured pixel, so it is defined here where the
+	// rasterisers can inline it
+	inline size_t Sampler::index(size_t x, size_t y) const {
+		if (layout == TextureLayout::LINEAR) return x + width * y;
+		return ((y / tile) * tiles_x + x / tile) * tile * tile
+			+ (y % tile) * tile + x % tile;
+	}
+
+	// Textures are loaded once and referred to by handle afterwards,
+	// loading the same file twice gives back the same handle, tiled
+	// copies are only built once the tiled layout is asked for
+	class TextureRegistry {
+	private:
+
+		// Every level past the first halves the one before it, so the
+		// levels cost a third of the texture again at most
+		struct Texture {
+			std::unique_ptr<TextureMap> map{ };
+			std::vector<std::vector<uint32_t>> levels{ };
+			std::vector<std::vector<uint32_t>> tiled{ };
+			std::vector<Sampler> samplers{ };
+			std::vector<Sampler> tiled_samplers{ };
+		};
+
+		TextureLayout layout{ TextureLayout::LINEAR };
+		TextureFilter filter{ TextureFilter::NEAREST };
+		bool mipmapping{ true };
+		std::vector<std::string> names{ };
+		std::vector<std::unique_ptr<Texture>> textures{ };
+
+		void _mipmap(Texture& texture);
+		void _tile(Texture& texture);
+		void _link(std::vector<Sampler>& samplers);
+
+	public:
+
+		static const size_t none{ static_cast<size_t>(-1) };
+
+		size_t load(const std::string& filename);
+		const Sampler& sampler(size_t handle) const;
+		size_t size() const;
+
+		void setLayout(TextureLayout layout);
+		TextureLayout getLayout() const;
+		void setFilter(TextureFilter filter);
+		TextureFilter getFilter() const;
+		void setMipmapping(bool mipmapping);
+		bool getMipmapping() const;
+
+	};
+
+};
@@ -0,0 +1,46 @@
+#include "triangle.hpp"
+
+Triangle::Triangle() { }
+Triangle::Triangle(size_t object, size_t element, size_t face,
+	const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	: object{ object }, element{ element }, face{ face },
+	a{ a }, e1{ b - a }, e2{ c - a },
+	normal{ glm::normalize(glm::cross(b - a, c - a)) } { }
+
+glm::vec3 Triangle::b() const {
+	return a + e1;
+}
+glm::vec3 Triangle::c() const {
+	return a + e2;
+}
+glm::vec3 Triangle::point(float u, float v) const {
+	return a + u * e1 + v * e2;
+}
+
+bool Triangle::intersect(const glm::vec3& from,
+	const glm::vec3& ray,
+	float t_min, float t_max,
+	Hit& hit) const {
+	// Moller-Trumbore, every bound is checked against values scaled
+	// by the determinant so the only division is for an accepted hit
+	const glm::vec3 p{ glm::cross(ray, e2) };
+	float det{ glm::dot(e1, p) };
+	if (det == 0) return false;
+	const float sign{ det < 0 ? -1.0f : 1.0f };
+	det *= sign;
+
+	const glm::vec3 s{ from - a };
+	const float u{ sign * glm::dot(s, p) };
+	if (u < 0 || u > det) return false;
+	const glm::vec3 q{ glm::cross(s, e1) };
+	const float v{ sign * glm::dot(ray, q) };
+	if (v < 0 || u + v >= det) return false;
+	const float t{ sign * glm::dot(e2, q) };
+	if (t <= t_min * det || t >= t_max * det) return false;
+
+	const float inverse{ 1.0f / det };
+	hit.t = t * inverse;
+	hit.u = u * inverse;
+	hit.v = v * inverse;
+	return true;
+}
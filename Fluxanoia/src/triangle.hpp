@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+struct Hit {
+	float t{ 0 }, u{ 0 }, v{ 0 };
+	size_t triangle{ 0 };
+};
+
+// Edges and normal are precomputed when the scene is loaded so a
+// ray/triangle test is a handful of dot and cross products
+struct Triangle {
+	size_t object{ 0 }, element{ 0 }, face{ 0 };
+	glm::vec3 a{ }, e1{ }, e2{ }, normal{ };
+
+	Triangle();
+	Triangle(size_t object, size_t element, size_t face,
+		const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+
+	glm::vec3 b() const;
+	glm::vec3 c() const;
+	glm::vec3 point(float u, float v) const;
+
+	bool intersect(const glm::vec3& from,
+		const glm::vec3& ray,
+		float t_min, float t_max,
+		Hit& hit) const;
+};